@@ -0,0 +1,187 @@
+#include "MaxRects.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+//times MaxRects against the full pairwise prune it used to run after every placement, on 512 mixed size sprites, and
+//checks both place every sprite in the same spot. the free rect grid and simd fit came later and are timed along with
+//the incremental prune. usage: PruneBenchmark [num_sprites] [repeats]
+
+constexpr int DEFAULT_NUM_SPRITES = 512;
+constexpr int DEFAULT_REPEATS = 20;
+constexpr unsigned SEED = 1;
+
+//MaxRects as it was before free rects were pruned incrementally, with short side fit and no padding or rotation.
+//every placement splits the free rects it overlaps and then checks every pair of free rects for enclosure
+class FullPruneMaxRects
+{
+public:
+	bool PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices)
+	{
+		free_rects_.clear();
+		free_rects_.push_back({ 0, 0, size.x, size.y });
+
+		for (int curr_idx : sorted_indices) {
+			int best_short_side_fit = INT_MAX;
+			int best_fit_index = -1;
+			for (int i = 0; i < free_rects_.size(); ++i) {
+				int leftover_width = free_rects_[i].w - rects[curr_idx].w;
+				int leftover_height = free_rects_[i].h - rects[curr_idx].h;
+				int shortest_side = std::min(leftover_width, leftover_height);
+
+				if (shortest_side >= 0 && shortest_side < best_short_side_fit) {
+					best_short_side_fit = shortest_side;
+					best_fit_index = i;
+				}
+			}
+
+			if (best_fit_index == -1) {
+				return false;
+			}
+
+			Rect placed = free_rects_[best_fit_index];
+			placed.w = rects[curr_idx].w;
+			placed.h = rects[curr_idx].h;
+			rects[curr_idx].x = placed.x;
+			rects[curr_idx].y = placed.y;
+
+			int num_rects_left = free_rects_.size();
+			for (int i = 0; i < num_rects_left; ++i) {
+				if (Intersects(placed, free_rects_[i])) {
+					PushSplitRects(placed, free_rects_[i]);
+					free_rects_.erase(free_rects_.begin() + i);
+					--i;
+					--num_rects_left;
+				}
+			}
+
+			for (int i = 0; i < free_rects_.size(); ++i) {
+				for (int j = i + 1; j < free_rects_.size(); ++j) {
+					if (Enclosed(free_rects_[i], free_rects_[j])) {
+						free_rects_.erase(free_rects_.begin() + i);
+						--i;
+						break;
+					}
+					else if (Enclosed(free_rects_[j], free_rects_[i])) {
+						free_rects_.erase(free_rects_.begin() + j);
+						--j;
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+private:
+	static bool Intersects(const Rect& a, const Rect& b)
+	{
+		return !(a.x >= b.x + b.w || a.x + a.w <= b.x || a.y >= b.y + b.h || a.y + a.h <= b.y);
+	}
+
+	static bool Enclosed(const Rect& a, const Rect& b)
+	{
+		return a.x >= b.x && a.y >= b.y && a.x + a.w <= b.x + b.w && a.y + a.h <= b.y + b.h;
+	}
+
+	void PushSplitRects(const Rect& placed, Rect free_rect)
+	{
+		if (placed.y > free_rect.y) {
+			free_rects_.push_back({ free_rect.x, free_rect.y, free_rect.w, placed.y - free_rect.y });
+		}
+		if (free_rect.y + free_rect.h > placed.y + placed.h) {
+			free_rects_.push_back({ free_rect.x, placed.y + placed.h, free_rect.w, free_rect.y + free_rect.h - (placed.y + placed.h) });
+		}
+		if (placed.x > free_rect.x) {
+			free_rects_.push_back({ free_rect.x, free_rect.y, placed.x - free_rect.x, free_rect.h });
+		}
+		if (free_rect.x + free_rect.w > placed.x + placed.w) {
+			free_rects_.push_back({ placed.x + placed.w, free_rect.y, free_rect.x + free_rect.w - (placed.x + placed.w), free_rect.h });
+		}
+	}
+
+	std::vector<Rect> free_rects_;
+};
+
+//4 to 64 pixels on each side, with every fifth sprite 3 times wider
+static std::vector<Rect> MakeSprites(int num_sprites)
+{
+	std::mt19937 rng(SEED);
+	std::vector<Rect> sprites(num_sprites);
+	for (int i = 0; i < num_sprites; ++i) {
+		sprites[i].w = 4 + rng() % 61;
+		sprites[i].h = 4 + rng() % 61;
+		if (i % 5 == 0) {
+			sprites[i].w *= 3;
+		}
+	}
+
+	return sprites;
+}
+
+template <typename PackFunc>
+static double TimePacks(int repeats, PackFunc pack)
+{
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; ++i) {
+		pack();
+	}
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+int main(int argc, char** argv)
+{
+	int num_sprites = argc > 1 ? std::max(atoi(argv[1]), 1) : DEFAULT_NUM_SPRITES;
+	int repeats = argc > 2 ? std::max(atoi(argv[2]), 1) : DEFAULT_REPEATS;
+
+	std::vector<Rect> sprites = MakeSprites(num_sprites);
+	long long total_area = 0;
+	for (const Rect& sprite : sprites) {
+		total_area += (long long)sprite.w * sprite.h;
+	}
+
+	//tallest first, the default sort order
+	std::vector<int> sorted_indices(num_sprites);
+	for (int i = 0; i < num_sprites; ++i) {
+		sorted_indices[i] = i;
+	}
+	std::stable_sort(sorted_indices.begin(), sorted_indices.end(), [&](int a, int b) { return sprites[a].h > sprites[b].h; });
+
+	//smallest square MaxRects fits them in, so the free lists are as long as they get in a real size search
+	MaxRects max_rects;
+	std::vector<Rect> rects = sprites;
+	int side = (int)std::sqrt((double)total_area);
+	while (!max_rects.PackAtlas(rects.data(), { side, side }, sorted_indices, 0, MaxRectsHeuristic::BestShortSideFit, false, 0)) {
+		++side;
+	}
+
+	std::vector<Rect> full_prune_rects = sprites;
+	FullPruneMaxRects full_prune;
+	if (!full_prune.PackAtlas(full_prune_rects.data(), { side, side }, sorted_indices)) {
+		printf("full prune packer did not fit %i sprites in %ix%i\n", num_sprites, side, side);
+		return 1;
+	}
+
+	int num_moved = 0;
+	for (int i = 0; i < num_sprites; ++i) {
+		num_moved += rects[i].x != full_prune_rects[i].x || rects[i].y != full_prune_rects[i].y;
+	}
+
+	double full_prune_ms = TimePacks(repeats, [&]() { full_prune.PackAtlas(full_prune_rects.data(), { side, side }, sorted_indices); });
+	double incremental_ms = TimePacks(repeats, [&]() { max_rects.PackAtlas(rects.data(), { side, side }, sorted_indices, 0, MaxRectsHeuristic::BestShortSideFit, false, 0); });
+
+	printf("%i sprites in %ix%i, mean of %i packs\n", num_sprites, side, side, repeats);
+	printf("full prune:        %8.3f ms\n", full_prune_ms);
+	printf("incremental prune: %8.3f ms\n", incremental_ms);
+	printf("speedup:           %8.2fx\n", full_prune_ms / incremental_ms);
+	printf("placements that differ: %i\n", num_moved);
+
+	return num_moved == 0 ? 0 : 1;
+}
@@ -0,0 +1,71 @@
+#include "AtlasPacker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+//times MaxRects on 1k, 10k and 100k small sprites, to check packing time grows about linearly with the number of
+//images. each count is packed with the fast solver, and once at the fixed maximum size. only the layout is created, so
+//no pixels are copied. usage: ScalingBenchmark [max_sprites]
+
+constexpr int DEFAULT_MAX_SPRITES = 100000;
+constexpr int PADDING = 1;
+constexpr unsigned SEED = 1;
+
+//4 to 16 pixels on each side
+static ImageData MakeSprites(int num_sprites)
+{
+	std::mt19937 rng(SEED);
+	ImageData images;
+	for (int i = 0; i < num_sprites; ++i) {
+		images.AddImage("sprite" + std::to_string(i), 4 + rng() % 13, 4 + rng() % 13);
+	}
+
+	return images;
+}
+
+//returns the time CreateLayout took in ms, or a negative time if the sprites did not fit
+static double TimeLayout(ImageData& images, SizeSolver size_solver)
+{
+	AtlasPacker packer;
+	packer.algo_ = Algorithm::MaxRects;
+	packer.size_solver_ = size_solver;
+	packer.pixel_padding_ = PADDING;
+
+	auto start = std::chrono::steady_clock::now();
+	int num_pages = packer.CreateLayout(images);
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	return num_pages == -1 ? -1.0 : ms;
+}
+
+int main(int argc, char** argv)
+{
+	int max_sprites = argc > 1 ? std::max(atoi(argv[1]), 1) : DEFAULT_MAX_SPRITES;
+
+	printf("MaxRects, short side fit, %i px padding, sprites 4-16 px\n", PADDING);
+	printf("%9s %12s %12s %14s %12s\n", "sprites", "fast (ms)", "us/sprite", "fixed (ms)", "us/sprite");
+
+	bool failed = false;
+	for (int num_sprites = 1000; num_sprites <= max_sprites; num_sprites *= 10) {
+		ImageData images = MakeSprites(num_sprites);
+
+		double fixed_ms = TimeLayout(images, SizeSolver::Fixed);
+		double fast_ms = TimeLayout(images, SizeSolver::Fast);
+		if (fast_ms < 0.0 || fixed_ms < 0.0) {
+			printf("%9i did not fit in %ix%i\n", num_sprites, MAX_DIMENSIONS, MAX_DIMENSIONS);
+			failed = true;
+			continue;
+		}
+
+		printf("%9i %12.1f %12.2f %14.1f %12.2f   fast size %ix%i\n", num_sprites, fast_ms, fast_ms * 1000.0 / num_sprites,
+			fixed_ms, fixed_ms * 1000.0 / num_sprites, images.atlas_rects_[0].w, images.atlas_rects_[0].h);
+		images.Clear();
+	}
+
+	return failed ? 1 : 0;
+}
@@ -44,11 +44,7 @@ Application::Application(int width, int height)
 
 Application::~Application()
 {
-	for (int i = 0; i < MAX_IMAGES; ++i) {
-		if (image_data_.data_[i] != nullptr) {
-			delete image_data_.data_[i];
-		}
-	}
+	image_data_.Clear();
 	glfwTerminate();
 }
 
@@ -145,12 +141,69 @@ void Application::RenderInputState()
 	ImGui::PushItemWidth(200);
 	ImGui::Text("Algorith: ");
 	ImGui::SameLine(100);
-	if (ImGui::BeginCombo("##Algorithm", atlas_packer_.algo_ == Algorithm::Shelf ? "Shelf" : "MaxRects")) {
-		if (ImGui::Selectable("Shelf")) {
-			atlas_packer_.algo_ = Algorithm::Shelf;
+	static const char* algorithm_names[] = { "Shelf", "MaxRects", "Skyline", "Guillotine", "Auto" };
+	if (ImGui::BeginCombo("##Algorithm", algorithm_names[(int)atlas_packer_.algo_])) {
+		for (int i = 0; i < IM_ARRAYSIZE(algorithm_names); ++i) {
+			if (ImGui::Selectable(algorithm_names[i])) {
+				atlas_packer_.algo_ = (Algorithm)i;
+			}
 		}
-		else if (ImGui::Selectable("MaxRects")) {
-			atlas_packer_.algo_ = Algorithm::MaxRects;
+		ImGui::EndCombo();
+	}
+
+	if (atlas_packer_.algo_ == Algorithm::Shelf) {
+		static const char* shelf_rule_names[] = { "Next Fit", "First Fit", "Best Height Fit" };
+		ImGui::Text("Shelf Rule: ");
+		ImGui::SameLine(100);
+		if (ImGui::BeginCombo("##ShelfRule", shelf_rule_names[(int)atlas_packer_.shelf_rule_])) {
+			for (int i = 0; i < IM_ARRAYSIZE(shelf_rule_names); ++i) {
+				if (ImGui::Selectable(shelf_rule_names[i])) {
+					atlas_packer_.shelf_rule_ = (ShelfRule)i;
+				}
+			}
+			ImGui::EndCombo();
+		}
+	}
+
+	if (atlas_packer_.algo_ == Algorithm::MaxRects) {
+		static const char* heuristic_names[] = { "Best Short Side Fit", "Best Long Side Fit", "Best Area Fit", "Bottom Left", "Contact Point", "Best of All" };
+		ImGui::Text("Heuristic: ");
+		ImGui::SameLine(100);
+		if (ImGui::BeginCombo("##Heuristic", heuristic_names[(int)atlas_packer_.heuristic_])) {
+			for (int i = 0; i < IM_ARRAYSIZE(heuristic_names); ++i) {
+				if (ImGui::Selectable(heuristic_names[i])) {
+					atlas_packer_.heuristic_ = (MaxRectsHeuristic)i;
+				}
+			}
+			ImGui::EndCombo();
+		}
+	}
+
+	if (atlas_packer_.algo_ == Algorithm::Guillotine) {
+		static const char* split_names[] = { "Shorter Axis", "Longer Axis", "Min Area", "Max Area" };
+		ImGui::Text("Split: ");
+		ImGui::SameLine(100);
+		if (ImGui::BeginCombo("##GuillotineSplit", split_names[(int)atlas_packer_.guillotine_split_])) {
+			for (int i = 0; i < IM_ARRAYSIZE(split_names); ++i) {
+				if (ImGui::Selectable(split_names[i])) {
+					atlas_packer_.guillotine_split_ = (GuillotineSplit)i;
+				}
+			}
+			ImGui::EndCombo();
+		}
+		ImGui::Text("Merge: ");
+		ImGui::SameLine(100);
+		ImGui::Checkbox("##GuillotineMerge", &atlas_packer_.guillotine_merge_);
+	}
+
+	static const char* sort_order_names[] = { "Height", "Width", "Area", "Perimeter", "Max Side", "Ratio", "Best of All" };
+	ImGui::Text("Sort Order: ");
+	ImGui::SameLine(100);
+	if (ImGui::BeginCombo("##SortOrder", sort_order_names[(int)atlas_packer_.sort_order_])) {
+		for (int i = 0; i < IM_ARRAYSIZE(sort_order_names); ++i) {
+			if (ImGui::Selectable(sort_order_names[i])) {
+				atlas_packer_.sort_order_ = (SortOrder)i;
+			}
 		}
 		ImGui::EndCombo();
 	}
@@ -171,9 +224,44 @@ void Application::RenderInputState()
 			atlas_packer_.size_solver_ = SizeSolver::Fixed;
 			combo_text = "Fixed";
 		}
+		else if (ImGui::Selectable("Optimize")) {
+			atlas_packer_.size_solver_ = SizeSolver::Optimize;
+			combo_text = "Optimize";
+		}
+		else if (ImGui::Selectable("Exact")) {
+			atlas_packer_.size_solver_ = SizeSolver::Exact;
+			combo_text = "Exact";
+		}
 		ImGui::EndCombo();
 	}
 
+	if (atlas_packer_.size_solver_ == SizeSolver::Optimize || atlas_packer_.size_solver_ == SizeSolver::Exact) {
+		ImGui::Text("Budget (ms): ");
+		ImGui::SameLine(100);
+		if (ImGui::InputInt("##TimeBudget", &atlas_packer_.time_budget_ms_, 100)) {
+			atlas_packer_.time_budget_ms_ = std::max(atlas_packer_.time_budget_ms_, 0);
+		}
+	}
+
+	//0 searches every width for the smallest area
+	if (atlas_packer_.size_solver_ == SizeSolver::Exact) {
+		ImGui::Text("Exact Width: ");
+		ImGui::SameLine(100);
+		if (ImGui::InputInt("##ExactWidth", &atlas_packer_.exact_width_)) {
+			atlas_packer_.exact_width_ = std::clamp(atlas_packer_.exact_width_, 0, MAX_DIMENSIONS);
+		}
+	}
+
+	if (atlas_packer_.size_solver_ == SizeSolver::BestFit || atlas_packer_.size_solver_ == SizeSolver::Optimize) {
+		ImGui::Text("Verify Size: ");
+		ImGui::SameLine(100);
+		ImGui::Checkbox("##VerifySize", &atlas_packer_.verify_size_);
+	}
+
+	ImGui::Text("Use Grids: ");
+	ImGui::SameLine(100);
+	ImGui::Checkbox("##UseGrids", &atlas_packer_.use_grids_);
+
 	ImGui::Text("Pixel Padding: ");
 	ImGui::SameLine(100);
 	if (ImGui::InputInt("##Padding", &atlas_packer_.pixel_padding_)) {
@@ -205,6 +293,15 @@ void Application::RenderInputState()
 	
 
 	if (!(atlas_packer_.size_solver_ == SizeSolver::Fixed)) {
+		//optimize already keeps every core busy with whole packings
+		if (atlas_packer_.size_solver_ != SizeSolver::Optimize) {
+			ImGui::Text("Parallel Sizes: ");
+			ImGui::SameLine(100);
+			if (ImGui::InputInt("##ParallelSizes", &atlas_packer_.num_parallel_sizes_)) {
+				atlas_packer_.num_parallel_sizes_ = std::clamp(atlas_packer_.num_parallel_sizes_, 1, MAX_PARALLEL_SIZES);
+			}
+		}
+
 		ImGui::Text("Force Square: ");
 		ImGui::SameLine(100);
 		ImGui::Checkbox("##ForceSquare", &atlas_packer_.force_square_);
@@ -214,37 +311,26 @@ void Application::RenderInputState()
 		ImGui::Checkbox("##Powof2", &atlas_packer_.pow_of_2_);
 	}
 
+	ImGui::Text("Allow Rotation: ");
+	ImGui::SameLine(100);
+	ImGui::Checkbox("##AllowRotation", &atlas_packer_.allow_rotation_);
+
+	ImGui::Text("Multi Page: ");
+	ImGui::SameLine(100);
+	ImGui::Checkbox("##MultiPage", &atlas_packer_.multi_page_);
+
 	ImGui::Separator();
 	if (input_items_.empty()) {
 		ImGuiErrorText("You must add an item to submit");
 	}
-	if (max_images_exceeded_) {
-		ImGuiErrorText("The max number of images per atlas has been exceeded");
-	}
 
 	if (ImGui::Button("Submit") && !input_items_.empty()) {
 		UnpackInputFolders();
-		max_images_exceeded_ = unpacked_items_.size() > MAX_IMAGES;
-		if (max_images_exceeded_) {
-			unpacked_items_.clear();
-			return;
-		}
 		if (!unpacked_items_.empty()) {
-			GetImageData(unpacked_items_, image_data_);
-			//returns index of image_data_ that the atlas image data resides. equivalent to image_data_.num_images
-			atlas_index_ = atlas_packer_.CreateAtlas(image_data_);
-
-			//used to display preview in output window
-			atlas_texture_ID_ = CreateAtlasTexture(atlas_index_);
+			//pages are stored in image_data_.atlas_rects_ and atlas_data_
+			CreateAtlas();
 
-
-			if (image_data_.rects_[atlas_index_].w <= 512 && image_data_.rects_[atlas_index_].h <= 512) {
-				preview_size_ = { image_data_.rects_[atlas_index_].w, image_data_.rects_[atlas_index_].h };
-			}
-			else {
-				float aspect_ratio = image_data_.rects_[atlas_index_].w / (float)image_data_.rects_[atlas_index_].h;
-				preview_size_ = aspect_ratio < 1 ? Vec2{ (int)(512 * aspect_ratio), 512 } : Vec2{ 512, (int)(512 * (1 / aspect_ratio)) };
-			}
+			SetPreviewPage(0);
 
 			PushState(State::Output);
 		}
@@ -255,21 +341,49 @@ void Application::RenderOutputState()
 {
 	ImGui::Text("Preview");
 
-	if (atlas_texture_ID_ == -1 || atlas_index_ == -1) {
+	if (atlas_texture_ID_ == -1 || num_pages_ <= 0) {
 		ImGuiErrorText("Unable to create atlas");
 	}
 	else {
 
-		ImGui::Text("Width: %i, Height: %i", image_data_.rects_[atlas_index_].w, image_data_.rects_[atlas_index_].h);
+		if (num_pages_ > 1) {
+			ImGui::Text("Page: ");
+			ImGui::SameLine(100);
+			if (ImGui::SliderInt("##PreviewPage", &preview_page_, 0, num_pages_ - 1)) {
+				SetPreviewPage(preview_page_);
+			}
+		}
+
+		ImGui::Text("Width: %i, Height: %i", image_data_.atlas_rects_[preview_page_].w, image_data_.atlas_rects_[preview_page_].h);
 
 		ImGui::Image((void*)(intptr_t)atlas_texture_ID_, { (float)preview_size_.x, (float)preview_size_.y }, { 0,0 }, { 1,1 }, { 1,1,1,1 }, { 1,1,1,1 });
 
 
 		ImGui::Separator();
 		ImGui::Text("Stats:");
-		ImGui::Text("Unused area: %i px", atlas_packer_.stats_.unused_area);
+		ImGui::Text("Unused area: %lld px", atlas_packer_.stats_.unused_area);
 		ImGui::Text("Packing efficiency: %.2f%%", atlas_packer_.stats_.packing_efficiency);
 		ImGui::Text("Time to pack: %.2f ms", atlas_packer_.stats_.time_elapsed_in_ms);
+		ImGui::Text("Sizes skipped by bounds: %i", atlas_packer_.stats_.rejected_sizes);
+		if (atlas_packer_.size_solver_ == SizeSolver::Optimize) {
+			ImGui::Text("Packings tried: %i", atlas_packer_.stats_.optimize_runs);
+		}
+		if (atlas_packer_.size_solver_ == SizeSolver::Exact) {
+			ImGui::Text("Pages proven smallest: %i", atlas_packer_.stats_.proven_pages);
+		}
+		if (atlas_packer_.stats_.grid_pages > 0) {
+			ImGui::Text("Pages laid out as a grid: %i", atlas_packer_.stats_.grid_pages);
+		}
+		if (atlas_packer_.stats_.grid_blocks > 0) {
+			ImGui::Text("Grid blocks packed: %i", atlas_packer_.stats_.grid_blocks);
+		}
+		if (!atlas_packer_.stats_.fit_kernel.empty()) {
+			ImGui::Text("MaxRects fit kernel: %s", atlas_packer_.stats_.fit_kernel.c_str());
+		}
+		if (atlas_packer_.algo_ == Algorithm::Auto && !atlas_packer_.stats_.auto_choice.empty()) {
+			ImGui::Text("Auto picked: %s", atlas_packer_.stats_.auto_choice.c_str());
+			ImGui::TextWrapped("%s", atlas_packer_.stats_.auto_reason.c_str());
+		}
 	}
 
 	ImGui::PushItemWidth(200);
@@ -357,28 +471,54 @@ void Application::SetImGuiStyle()
 
 void Application::Save(const std::string& save_folder)
 {
-	int success;
-
-	if (output_format_ == OutputFormat::PNG) {
-		std::string full_path(save_folder + "/atlas.png");
-		success = stbi_write_png(full_path.c_str(), image_data_.rects_[atlas_index_].w, image_data_.rects_[atlas_index_].h, 4, (void*)image_data_.data_[atlas_index_], image_data_.rects_[atlas_index_].w * 4);
-	}
-	else {
-		std::string full_path(save_folder + "/atlas.jpg");
-		success = stbi_write_jpg(full_path.c_str(), image_data_.rects_[atlas_index_].w, image_data_.rects_[atlas_index_].h, 4, (void*)image_data_.data_[atlas_index_], jpg_quality_);
-	}
-	if (!success) {
-		std::cout << "Unable to save image";
+	if (num_pages_ <= 0) {
 		return;
 	}
 
+	//layout only atlases have no pixels to save
+	for (int page = 0; page < image_data_.atlas_data_.size(); ++page) {
+		//multi page atlases are always numbered so the file names do not depend on how many pages were needed
+		std::string name = atlas_packer_.multi_page_ ? "/atlas_" + std::to_string(page) : "/atlas";
+		const Rect& rect = image_data_.atlas_rects_[page];
+		int success;
+
+		if (output_format_ == OutputFormat::PNG) {
+			std::string full_path(save_folder + name + ".png");
+			success = stbi_write_png(full_path.c_str(), rect.w, rect.h, 4, (void*)image_data_.atlas_data_[page], rect.w * 4);
+		}
+		else {
+			std::string full_path(save_folder + name + ".jpg");
+			success = stbi_write_jpg(full_path.c_str(), rect.w, rect.h, 4, (void*)image_data_.atlas_data_[page], jpg_quality_);
+		}
+		if (!success) {
+			std::cout << "Unable to save image";
+			return;
+		}
+	}
+
 	std::ofstream file(save_folder + "/atlas-data.txt");
 	file << atlas_packer_.metadata_ << std::endl;
 }
 
-unsigned int Application::CreateAtlasTexture(int image_index)
+void Application::CreateAtlas()
 {
-	if (image_data_.data_[image_index] == nullptr) {
+	GetImageSizes(unpacked_items_, image_data_);
+	num_pages_ = atlas_packer_.CreateLayout(image_data_);
+	if (layout_only_ || num_pages_ == -1) {
+		return;
+	}
+
+	//every image is decoded straight into its place in the atlas and freed, so alongside the atlas only the images
+	//being decoded are held in memory
+	atlas_packer_.CreateAtlasPages(image_data_);
+	LoadImagePixels(unpacked_items_, image_data_, [this](int index, const unsigned char* pixels) {
+		AtlasPacker::CopyToAtlas(image_data_, index, pixels);
+	});
+}
+
+unsigned int Application::CreateAtlasTexture(int page)
+{
+	if (page >= image_data_.atlas_data_.size()) {
 		return -1;
 	}
 	unsigned int image_texture;
@@ -389,11 +529,34 @@ unsigned int Application::CreateAtlasTexture(int image_index)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_data_.rects_[image_index].w, image_data_.rects_[image_index].h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data_.data_[image_index]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_data_.atlas_rects_[page].w, image_data_.atlas_rects_[page].h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data_.atlas_data_[page]);
 
 	return image_texture;
 }
 
+void Application::SetPreviewPage(int page)
+{
+	if (atlas_texture_ID_ != -1) {
+		glDeleteTextures(1, &atlas_texture_ID_);
+	}
+
+	preview_page_ = page;
+	//used to display preview in output window
+	atlas_texture_ID_ = num_pages_ > 0 ? CreateAtlasTexture(page) : -1;
+	if (atlas_texture_ID_ == -1) {
+		return;
+	}
+
+	const Rect& rect = image_data_.atlas_rects_[page];
+	if (rect.w <= 512 && rect.h <= 512) {
+		preview_size_ = { rect.w, rect.h };
+	}
+	else {
+		float aspect_ratio = rect.w / (float)rect.h;
+		preview_size_ = aspect_ratio < 1 ? Vec2{ (int)(512 * aspect_ratio), 512 } : Vec2{ 512, (int)(512 * (1 / aspect_ratio)) };
+	}
+}
+
 void Application::CreateAtlasFromCmdLine(int argc, char** argv)
 {
 	int index = 1;
@@ -413,6 +576,15 @@ void Application::CreateAtlasFromCmdLine(int argc, char** argv)
 			if (arg == "max-rects") {
 				atlas_packer_.algo_ = Algorithm::MaxRects;
 			}
+			else if (arg == "skyline") {
+				atlas_packer_.algo_ = Algorithm::Skyline;
+			}
+			else if (arg == "guillotine") {
+				atlas_packer_.algo_ = Algorithm::Guillotine;
+			}
+			else if (arg == "auto") {
+				atlas_packer_.algo_ = Algorithm::Auto;
+			}
 			//Shelf is default so no need to set
 			else if (arg != "shelf") {
 				std::cout << arg << " is not a valid algorithm\n";
@@ -421,6 +593,117 @@ void Application::CreateAtlasFromCmdLine(int argc, char** argv)
 			//additonal increment to go past arg and get to next option
 			++index;
 		}
+		else if (option == "-hr" || option == "--heuristic") {
+			if (index + 1 >= argc) {
+				std::cout << "No arguments have been provided for " << option << ".\n";
+				return;
+			}
+			std::string arg = argv[index + 1];
+			if (arg == "short-side") {
+				atlas_packer_.heuristic_ = MaxRectsHeuristic::BestShortSideFit;
+			}
+			else if (arg == "long-side") {
+				atlas_packer_.heuristic_ = MaxRectsHeuristic::BestLongSideFit;
+			}
+			else if (arg == "area") {
+				atlas_packer_.heuristic_ = MaxRectsHeuristic::BestAreaFit;
+			}
+			else if (arg == "bottom-left") {
+				atlas_packer_.heuristic_ = MaxRectsHeuristic::BottomLeft;
+			}
+			else if (arg == "contact-point") {
+				atlas_packer_.heuristic_ = MaxRectsHeuristic::ContactPoint;
+			}
+			else if (arg == "best") {
+				atlas_packer_.heuristic_ = MaxRectsHeuristic::Best;
+			}
+			else {
+				std::cout << arg << " is not a valid heuristic.\n";
+				return;
+			}
+			++index;
+		}
+		else if (option == "-so" || option == "--sort-order") {
+			if (index + 1 >= argc) {
+				std::cout << "No arguments have been provided for " << option << ".\n";
+				return;
+			}
+			std::string arg = argv[index + 1];
+			if (arg == "height") {
+				atlas_packer_.sort_order_ = SortOrder::Height;
+			}
+			else if (arg == "width") {
+				atlas_packer_.sort_order_ = SortOrder::Width;
+			}
+			else if (arg == "area") {
+				atlas_packer_.sort_order_ = SortOrder::Area;
+			}
+			else if (arg == "perimeter") {
+				atlas_packer_.sort_order_ = SortOrder::Perimeter;
+			}
+			else if (arg == "max-side") {
+				atlas_packer_.sort_order_ = SortOrder::MaxSide;
+			}
+			else if (arg == "ratio") {
+				atlas_packer_.sort_order_ = SortOrder::Ratio;
+			}
+			else if (arg == "all") {
+				atlas_packer_.sort_order_ = SortOrder::All;
+			}
+			else {
+				std::cout << arg << " is not a valid sort order.\n";
+				return;
+			}
+			++index;
+		}
+		else if (option == "-sr" || option == "--shelf-rule") {
+			if (index + 1 >= argc) {
+				std::cout << "No arguments have been provided for " << option << ".\n";
+				return;
+			}
+			std::string arg = argv[index + 1];
+			if (arg == "next-fit") {
+				atlas_packer_.shelf_rule_ = ShelfRule::NextFit;
+			}
+			else if (arg == "first-fit") {
+				atlas_packer_.shelf_rule_ = ShelfRule::FirstFit;
+			}
+			else if (arg == "best-height-fit") {
+				atlas_packer_.shelf_rule_ = ShelfRule::BestHeightFit;
+			}
+			else {
+				std::cout << arg << " is not a valid shelf rule.\n";
+				return;
+			}
+			++index;
+		}
+		else if (option == "-gs" || option == "--guillotine-split") {
+			if (index + 1 >= argc) {
+				std::cout << "No arguments have been provided for " << option << ".\n";
+				return;
+			}
+			std::string arg = argv[index + 1];
+			if (arg == "shorter-axis") {
+				atlas_packer_.guillotine_split_ = GuillotineSplit::ShorterAxis;
+			}
+			else if (arg == "longer-axis") {
+				atlas_packer_.guillotine_split_ = GuillotineSplit::LongerAxis;
+			}
+			else if (arg == "min-area") {
+				atlas_packer_.guillotine_split_ = GuillotineSplit::MinArea;
+			}
+			else if (arg == "max-area") {
+				atlas_packer_.guillotine_split_ = GuillotineSplit::MaxArea;
+			}
+			else {
+				std::cout << arg << " is not a valid split rule.\n";
+				return;
+			}
+			++index;
+		}
+		else if (option == "-ngm" || option == "--no-guillotine-merge") {
+			atlas_packer_.guillotine_merge_ = false;
+		}
 		else if (option == "-ss" || option == "--size-solver") {
 			if (index + 1 >= argc) {
 				std::cout << "No arguments have been provided for " << option << ".\n";
@@ -436,6 +719,12 @@ void Application::CreateAtlasFromCmdLine(int argc, char** argv)
 			else if (arg == "best-fit") {
 				atlas_packer_.size_solver_ = SizeSolver::BestFit;
 			}
+			else if (arg == "optimize") {
+				atlas_packer_.size_solver_ = SizeSolver::Optimize;
+			}
+			else if (arg == "exact") {
+				atlas_packer_.size_solver_ = SizeSolver::Exact;
+			}
 			else {
 				std::cout << arg << " is not a valid size solver.\n";
 				return;
@@ -481,6 +770,18 @@ void Application::CreateAtlasFromCmdLine(int argc, char** argv)
 			//additonal increment to use up both arg
 			index +=2 ;
 		}
+		else if (option == "-ps" || option == "--parallel-sizes") {
+			if (index + 1 >= argc) {
+				std::cout << "No arguments have been provided for " << option << ".\n";
+				return;
+			}
+			if (!IsNumber(argv[index + 1]) || std::stoi(argv[index + 1]) < 1) {
+				std::cout << argv[index + 1] << " is not a valid number of sizes.\n";
+				return;
+			}
+			atlas_packer_.num_parallel_sizes_ = std::min(std::stoi(argv[index + 1]), MAX_PARALLEL_SIZES);
+			++index;
+		}
 		else if (option == "-fs" || option == "--force-square") {
 			atlas_packer_.force_square_ = true;
 			if (atlas_packer_.size_solver_ == SizeSolver::Fixed) {
@@ -493,6 +794,45 @@ void Application::CreateAtlasFromCmdLine(int argc, char** argv)
 				std::cout << "Power of 2 is ignored for fixed size atlases.\n";
 			}
 		}
+		else if (option == "-vs" || option == "--verify-size") {
+			atlas_packer_.verify_size_ = true;
+		}
+		else if (option == "-ng" || option == "--no-grids") {
+			atlas_packer_.use_grids_ = false;
+		}
+		else if (option == "-tb" || option == "--time-budget-ms") {
+			if (index + 1 >= argc) {
+				std::cout << "No arguments have been provided for " << option << ".\n";
+				return;
+			}
+			if (!IsNumber(argv[index + 1])) {
+				std::cout << argv[index + 1] << " is not a valid number.\n";
+				return;
+			}
+			atlas_packer_.time_budget_ms_ = std::stoi(argv[index + 1]);
+			++index;
+		}
+		else if (option == "-ew" || option == "--exact-width") {
+			if (index + 1 >= argc) {
+				std::cout << "No arguments have been provided for " << option << ".\n";
+				return;
+			}
+			if (!IsNumber(argv[index + 1]) || std::stoi(argv[index + 1]) > MAX_DIMENSIONS) {
+				std::cout << argv[index + 1] << " is not a valid width.\n";
+				return;
+			}
+			atlas_packer_.exact_width_ = std::stoi(argv[index + 1]);
+			++index;
+		}
+		else if (option == "-ar" || option == "--allow-rotation") {
+			atlas_packer_.allow_rotation_ = true;
+		}
+		else if (option == "-mp" || option == "--multi-page") {
+			atlas_packer_.multi_page_ = true;
+		}
+		else if (option == "-lo" || option == "--layout-only") {
+			layout_only_ = true;
+		}
 		else if (option == "-of" || option == "--output-format") {
 			if (index + 1 >= argc) {
 				std::cout << "No arguments have been provided for " << option << ".\n";
@@ -541,20 +881,42 @@ void Application::CreateAtlasFromCmdLine(int argc, char** argv)
 		return;
 	}
 
-	GetImageData(unpacked_items_, image_data_);
-	atlas_index_ = atlas_packer_.CreateAtlas(image_data_);
-	Save(output_directory_);
+	CreateAtlas();
 
-	if (atlas_index_ == -1) {
+	if (num_pages_ == -1) {
 		std::cout << "Unable to create atlas with the current settings. Please try again.\n";
 		return;
 	}
 
+	Save(output_directory_);
+
 	std::cout << "Atlas creation complete.\n" <<
 		"Time to pack: " << atlas_packer_.stats_.time_elapsed_in_ms << "ms\n" <<
 		"Unused area:  " << atlas_packer_.stats_.unused_area << "px\n" <<
-		"Packing efficiency: " << std::fixed << std::setprecision(2) << atlas_packer_.stats_.packing_efficiency << "%\n";
-	std::cout << "Atlas saved to " << output_directory_ << ".\n";
+		"Packing efficiency: " << std::fixed << std::setprecision(2) << atlas_packer_.stats_.packing_efficiency << "%\n" <<
+		"Sizes skipped by bounds: " << atlas_packer_.stats_.rejected_sizes << "\n";
+	if (atlas_packer_.size_solver_ == SizeSolver::Optimize) {
+		std::cout << "Packings tried: " << atlas_packer_.stats_.optimize_runs << "\n";
+	}
+	if (atlas_packer_.size_solver_ == SizeSolver::Exact) {
+		std::cout << "Pages proven smallest: " << atlas_packer_.stats_.proven_pages << "\n";
+	}
+	if (atlas_packer_.stats_.grid_pages > 0) {
+		std::cout << "Pages laid out as a grid: " << atlas_packer_.stats_.grid_pages << "\n";
+	}
+	if (atlas_packer_.stats_.grid_blocks > 0) {
+		std::cout << "Grid blocks packed: " << atlas_packer_.stats_.grid_blocks << "\n";
+	}
+	if (!atlas_packer_.stats_.fit_kernel.empty()) {
+		std::cout << "MaxRects fit kernel: " << atlas_packer_.stats_.fit_kernel << "\n";
+	}
+	if (atlas_packer_.algo_ == Algorithm::Auto) {
+		std::cout << "Auto picked: " << atlas_packer_.stats_.auto_choice << "\n" << atlas_packer_.stats_.auto_reason << "\n";
+	}
+	if (atlas_packer_.multi_page_) {
+		std::cout << "Pages: " << num_pages_ << "\n";
+	}
+	std::cout << (layout_only_ ? "Atlas metadata saved to " : "Atlas saved to ") << output_directory_ << ".\n";
 }
 
 bool Application::IsNumber(const std::string& value)
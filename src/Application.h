@@ -39,7 +39,10 @@ public:
 	void Save(const std::string& save_folder);
 
 	void UnpackInputFolders();
-	unsigned int Application::CreateAtlasTexture(int image_index);
+	//packs unpacked_items_ from their sizes, then decodes their pixels into the atlas unless only the layout is wanted
+	void CreateAtlas();
+	unsigned int Application::CreateAtlasTexture(int page);
+	void SetPreviewPage(int page);
 	void CreateAtlasFromCmdLine(int argc, char** argv);
 	bool IsNumber(const std::string& value);
 
@@ -48,7 +51,9 @@ private:
 
 	AtlasPacker atlas_packer_;
 	ImageData image_data_;
-	int atlas_index_;
+	//-1 if the last atlas could not be created
+	int num_pages_ = -1;
+	int preview_page_ = 0;
 
 	Window window_;
 	FileDialog input_file_dialog_;
@@ -56,8 +61,9 @@ private:
 	int jpg_quality_ = 90;
 
 	std::string output_directory_;
+	//only the image headers are read, and only the metadata is saved
+	bool layout_only_ = false;
 	bool changing_save_folder_ = false;
-	bool max_images_exceeded_ = false;
 
 	OutputFormat output_format_ = OutputFormat::PNG;
 
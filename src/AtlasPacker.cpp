@@ -1,56 +1,1235 @@
 #include "AtlasPacker.h"
 
-#include "MaxRects.h"
+#include "FitKernel.h"
+#include "ThreadPool.h"
 
 #include <iostream>
 #include <sstream>
 #include <chrono>
 #include <numeric>
+#include <algorithm>
+#include <queue>
+#include <climits>
+#include <random>
+#include <cmath>
+#include <iomanip>
 
-void AtlasPacker::WriteAtlasImageData(ImageData& images, int width, int height)
+//algorithm settings the optimize solver cycles through
+struct OptimizeConfig
 {
-	int channels = 4;
-	int atlas_pitch = width * channels;
+	Algorithm algo;
+	MaxRectsHeuristic heuristic;
+	GuillotineSplit split;
+};
+
+static const OptimizeConfig OPTIMIZE_CONFIGS[] = {
+	{ Algorithm::MaxRects, MaxRectsHeuristic::BestShortSideFit, GuillotineSplit::ShorterAxis },
+	{ Algorithm::MaxRects, MaxRectsHeuristic::BestLongSideFit, GuillotineSplit::ShorterAxis },
+	{ Algorithm::MaxRects, MaxRectsHeuristic::BestAreaFit, GuillotineSplit::ShorterAxis },
+	{ Algorithm::MaxRects, MaxRectsHeuristic::BottomLeft, GuillotineSplit::ShorterAxis },
+	{ Algorithm::MaxRects, MaxRectsHeuristic::ContactPoint, GuillotineSplit::ShorterAxis },
+	{ Algorithm::Skyline, MaxRectsHeuristic::BestShortSideFit, GuillotineSplit::ShorterAxis },
+	{ Algorithm::Guillotine, MaxRectsHeuristic::BestShortSideFit, GuillotineSplit::ShorterAxis },
+	{ Algorithm::Guillotine, MaxRectsHeuristic::BestShortSideFit, GuillotineSplit::MinArea },
+	{ Algorithm::Shelf, MaxRectsHeuristic::BestShortSideFit, GuillotineSplit::ShorterAxis }
+};
+
+constexpr int NUM_OPTIMIZE_CONFIGS = sizeof(OPTIMIZE_CONFIGS) / sizeof(OPTIMIZE_CONFIGS[0]);
+
+//auto picks the quickest algorithm and size solver expected to pack at least this much of the atlas
+constexpr double AUTO_TARGET_EFFICIENCY = 0.9;
+//MaxRects packs the tightest but slows down with the cube of the images, so past this many auto falls back on Skyline
+constexpr int AUTO_MAX_RECTS_IMAGES = 100;
+//share of the atlas left between images even by the tightest packings. measured over mixed, glyph, icon and sprite sizes
+constexpr double AUTO_GAP_WASTE = 0.04;
+//space left along the right and bottom edges, in long sides of the average image per side of the atlas. measured
+constexpr double AUTO_EDGE_WASTE = 0.5;
 
-	unsigned char* pixels = new unsigned char[(size_t)height * atlas_pitch]();
+//the fast solver grows the atlas by this many pixels at a time
+constexpr int FAST_SIZE_STEP = 32;
 
+//the exact solver raises the area it searches below by 1/EXACT_AREA_STEPS of the image area at a time
+constexpr int EXACT_AREA_STEPS = 64;
+
+//images up to 1/GRID_TOLERANCE smaller than the largest on each side still count as the same size for a grid
+constexpr int GRID_TOLERANCE = 16;
+//sizes with fewer images than this on a page of several sizes are packed one by one instead of as a grid block
+constexpr int MIN_GRID_BLOCK_IMAGES = 8;
+//pages with less than 1/MIN_GRID_BLOCK_SHARE of their images in blocks are packed one by one
+constexpr int MIN_GRID_BLOCK_SHARE = 2;
+//grid blocks are laid out about as wide as the atlas, and as wide as each fraction of it down to 1/GRID_BLOCK_SPLITS
+constexpr int GRID_BLOCK_SPLITS = 4;
+//a page of nearly same sized images can pack tighter than a grid of the largest, but past this many images finding a
+//smaller size takes dozens of packs of the whole page for a few percent, so only the grid is used
+constexpr int MAX_GRID_SEARCH_IMAGES = 32;
+
+void AtlasPacker::WriteAtlasImageData(ImageData& images)
+{
+	CreateAtlasPages(images);
 	for (int i = 0; i < images.num_images_; ++i) {
+		//images that could not be decoded are left empty
+		if (images.data_[i] != nullptr) {
+			CopyToAtlas(images, i, images.data_[i]);
+		}
+	}
+}
+
+void AtlasPacker::CreateAtlasPages(ImageData& images)
+{
+	int channels = 4;
+	for (const Rect& page : images.atlas_rects_) {
+		images.atlas_data_.push_back(new unsigned char[(size_t)page.h * page.w * channels]());
+	}
+}
+
+void AtlasPacker::CopyToAtlas(ImageData& images, int index, const unsigned char* image_pixels)
+{
+	int channels = 4;
+	const Rect& rect = images.rects_[index];
 
-		int image_pitch = images.rects_[i].w * channels;
+	unsigned char* pixels = images.atlas_data_[images.pages_[index]];
+	int atlas_pitch = images.atlas_rects_[images.pages_[index]].w * channels;
+	int image_pitch = rect.w * channels;
 
-		int pen_x = images.rects_[i].x * channels;
-		int pen_y = images.rects_[i].y;
+	int pen_x = rect.x * channels;
+	int pen_y = rect.y;
 
-		for (int row = 0; row < images.rects_[i].h; ++row) {
-			for (int col = 0; col < image_pitch; ++col) {
-				int x = pen_x + col;
-				int y = pen_y + row;
-				pixels[y * (atlas_pitch)+x] = images.data_[i][row * (image_pitch)+col];
+	//turned 90 degrees clockwise, so each source row becomes a column running down from the top, starting at the right
+	if (rect.rotated) {
+		for (int row = 0; row < rect.h; ++row) {
+			int x = pen_x + (rect.h - 1 - row) * channels;
+			for (int col = 0; col < rect.w; ++col) {
+				int y = pen_y + col;
+				std::copy_n(&image_pixels[row * image_pitch + col * channels], channels, &pixels[y * atlas_pitch + x]);
 			}
 		}
+		return;
 	}
 
-	//set atlas data to be at the end of all images
-	images.rects_[images.num_images_] = { 0, 0, width, height };
-	if (images.data_[images.num_images_] != nullptr) {
-		delete images.data_[images.num_images_];
+	for (int row = 0; row < rect.h; ++row) {
+		std::copy_n(&image_pixels[row * image_pitch], image_pitch, &pixels[(pen_y + row) * atlas_pitch + pen_x]);
 	}
-	images.data_[images.num_images_] = pixels;
 }
 
 int AtlasPacker::CreateAtlas(ImageData& image_data)
 {
-	std::chrono::steady_clock::time_point start_time = std::chrono::high_resolution_clock::now();
+	int num_pages = CreateLayout(image_data);
+	if (num_pages != -1) {
+		WriteAtlasImageData(image_data);
+	}
+	return num_pages;
+}
+
+int AtlasPacker::CreateLayout(ImageData& image_data)
+{
+	for (unsigned char* page : image_data.atlas_data_) {
+		delete[] page;
+	}
+	image_data.atlas_rects_.clear();
+	image_data.atlas_data_.clear();
+
+	//packs with a copy so auto is still set, and picks again, for the next images
+	if (algo_ == Algorithm::Auto) {
+		AtlasPacker chosen = *this;
+		chosen.ChooseAlgorithm(image_data);
+		int num_pages = chosen.CreateLayout(image_data);
+		stats_ = chosen.stats_;
+		metadata_ = chosen.metadata_;
+		return num_pages;
+	}
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
 
 	stats_.total_images_area = 0;
+	stats_.rejected_sizes = 0;
+	stats_.optimize_runs = 0;
+	stats_.grid_pages = 0;
+	stats_.grid_blocks = 0;
+	stats_.proven_pages = 0;
+	bool timed = size_solver_ == SizeSolver::Optimize || size_solver_ == SizeSolver::Exact;
+	//the optimize and exact solvers pack with MaxRects short side fit among others
+	bool short_side_fit = algo_ == Algorithm::MaxRects && (heuristic_ == MaxRectsHeuristic::BestShortSideFit || heuristic_ == MaxRectsHeuristic::Best);
+	stats_.fit_kernel = short_side_fit || timed ? GetFitKernelName() : "";
+	deadline_ = timed ? start_time + std::chrono::milliseconds(time_budget_ms_) : std::chrono::steady_clock::time_point::max();
+	for (int i = 0; i < image_data.num_images_; ++i) {
+		stats_.total_images_area += (long long)image_data.rects_[i].w * image_data.rects_[i].h;
+	}
+
+	sorted_indices_ = GetSortedIndices(image_data);
+
+	std::vector<std::vector<int>> pages;
+	if (multi_page_) {
+		if (!SplitPages(image_data, pages)) {
+			return -1;
+		}
+	}
+	else {
+		pages.push_back(sorted_indices_);
+	}
+
+	std::vector<Vec2> page_sizes;
+	if (!PackPages(image_data, pages, page_sizes)) {
+		return -1;
+	}
+
+	std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+	stats_.time_elapsed_in_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+	stats_.atlas_area = 0;
+	for (Vec2 size : page_sizes) {
+		stats_.atlas_area += (long long)size.x * size.y;
+	}
+	stats_.unused_area = stats_.atlas_area - stats_.total_images_area;
+	stats_.packing_efficiency = (stats_.total_images_area / (float)stats_.atlas_area) * 100;
+
+	//contains x, y, w, h of all individual textures in atlas
+	metadata_ = GetAtlasMetadata(image_data);
+
+	for (Vec2 size : page_sizes) {
+		image_data.atlas_rects_.push_back({ 0, 0, size.x, size.y });
+	}
+
+	possible_sizes_.clear();
+	size_ = { 0,0 };
+
+	return page_sizes.size();
+}
+
+void AtlasPacker::ChooseAlgorithm(const ImageData& image_data)
+{
+	//sizes as packed, lying flat if they can be turned
+	std::vector<Vec2> sizes;
+	long long area = 0;
+	double sum_w = 0.0, sum_h = 0.0, sum_long = 0.0;
+	for (int i = 0; i < image_data.num_images_; ++i) {
+		Vec2 size = { image_data.rects_[i].w + pixel_padding_, image_data.rects_[i].h + pixel_padding_ };
+		if (allow_rotation_ && size.x < size.y) {
+			std::swap(size.x, size.y);
+		}
+		sizes.push_back(size);
+		area += (long long)size.x * size.y;
+		sum_w += size.x;
+		sum_h += size.y;
+		sum_long += std::max(size.x, size.y);
+	}
+
+	int num_images = std::max(image_data.num_images_, 1);
+	double mean_w = sum_w / num_images, mean_h = sum_h / num_images;
+
+	//the atlas is taken to be square, and no bigger than it has to be to hit the target
+	double side = std::max(std::sqrt(area / AUTO_TARGET_EFFICIENCY), 1.0);
+	//skyline and free rect packers leave a little space between images, and more along the right and bottom edges the
+	//longer the images are next to the atlas
+	double edge_waste = AUTO_GAP_WASTE + AUTO_EDGE_WASTE * sum_long / num_images / side;
+	//shelves leave the space above every image shorter than the first on its shelf instead, so this is where how much
+	//the heights vary comes in
+	double shelf_waste = AUTO_GAP_WASTE + EstimateShelfWaste(sizes, side);
+	//the fast solver overshoots the size the images need by about half a step each way. powers of two step alike
+	double step_waste = pow_of_2_ ? 0.0 : FAST_SIZE_STEP / side;
+
+	struct Choice
+	{
+		Algorithm algo;
+		SizeSolver solver;
+		double efficiency;
+	};
+
+	//by packing time, quickest first
+	bool choose_solver = size_solver_ == SizeSolver::Fast || size_solver_ == SizeSolver::BestFit;
+	std::vector<Choice> choices;
+	if (choose_solver) {
+		choices.push_back({ Algorithm::Shelf, SizeSolver::Fast, 1.0 - shelf_waste - step_waste });
+		choices.push_back({ Algorithm::Skyline, SizeSolver::Fast, 1.0 - edge_waste - step_waste });
+	}
+	SizeSolver searched_solver = choose_solver ? SizeSolver::BestFit : size_solver_;
+	choices.push_back({ Algorithm::Shelf, searched_solver, 1.0 - shelf_waste });
+	choices.push_back({ Algorithm::Skyline, searched_solver, 1.0 - edge_waste });
+
+	auto chosen = std::find_if(choices.begin(), choices.end(), [](const Choice& choice) { return choice.efficiency >= AUTO_TARGET_EFFICIENCY; });
+	bool reached = chosen != choices.end();
+	//if nothing is expected to reach the target, the tightest packer that is quick enough for this many images
+	Choice choice = reached ? *chosen : Choice{ image_data.num_images_ <= AUTO_MAX_RECTS_IMAGES ? Algorithm::MaxRects : Algorithm::Skyline, searched_solver, 1.0 - edge_waste };
+	algo_ = choice.algo;
+	size_solver_ = choice.solver;
+
+	static const char* algorithm_names[] = { "Shelf", "MaxRects", "Skyline", "Guillotine" };
+	static const char* solver_names[] = { "Fixed", "Fast", "Best Fit", "Optimize", "Exact" };
+	stats_.auto_choice = std::string(algorithm_names[(int)algo_]) + ", " + solver_names[(int)size_solver_];
+
+	std::ostringstream reason;
+	reason << std::fixed << std::setprecision(0) << image_data.num_images_ << " images of " << mean_w << "x" << mean_h << " on average. Shelves of their heights "
+		<< "are expected to leave " << shelf_waste * 100 << "% empty, Skyline " << edge_waste * 100 << "%. ";
+	if (reached) {
+		reason << "Expected to pack " << choice.efficiency * 100 << "% against a target of " << AUTO_TARGET_EFFICIENCY * 100 << "%.";
+	}
+	else {
+		reason << "Nothing quicker is expected to reach the target of " << AUTO_TARGET_EFFICIENCY * 100 << "%.";
+	}
+	stats_.auto_reason = reason.str();
+}
+
+double AtlasPacker::EstimateShelfWaste(std::vector<Vec2> sizes, double width)
+{
+	std::sort(sizes.begin(), sizes.end(), [](Vec2 a, Vec2 b) { return a.y > b.y; });
+
+	double empty = 0.0, used = 0.0;
+	double pen_x = 0.0;
+	int shelf_height = 0;
+	for (Vec2 size : sizes) {
+		if (pen_x + size.x > width && pen_x > 0.0) {
+			empty += (width - pen_x) * shelf_height;
+			used += width * shelf_height;
+			pen_x = 0.0;
+		}
+		if (pen_x == 0.0) {
+			shelf_height = size.y;
+		}
+		empty += (double)(shelf_height - size.y) * size.x;
+		pen_x += size.x;
+	}
+	empty += (width - pen_x) * shelf_height;
+	used += width * shelf_height;
+
+	return used > 0.0 ? empty / used : 0.0;
+}
+
+bool AtlasPacker::SplitPages(const ImageData& image_data, std::vector<std::vector<int>>& pages)
+{
+	//packers place images one at a time in sorted order and stop at the first that does not fit, so if some number of
+	//images fit in the maximum dimensions, every smaller number does too. each page takes the most remaining images
+	//that fit, found with a binary search, and its own smallest size is searched for afterwards. that only holds if
+	//nothing about the packing depends on the number of images, so MaxRects keeps the columns it picks for all of them.
+	//grids are not tried here, since a page that is not packed as a grid is packed the same way as below
+	std::vector<int> all_indices = sorted_indices_;
+	std::vector<Rect> rects(image_data.rects_.begin(), image_data.rects_.begin() + image_data.num_images_);
+	Vec2 max_size = { max_width_, max_height_ };
+
+	MaxRectsHeuristic heuristic = heuristic_;
+	if (heuristic_ == MaxRectsHeuristic::Best) {
+		heuristic_ = MaxRectsHeuristic::BestShortSideFit;
+	}
+	max_rects_columns_ = MaxRects::GetNumColumns(rects.data(), all_indices, max_width_, pixel_padding_, allow_rotation_);
+
+	bool split = true;
+	for (size_t first = 0; first < all_indices.size();) {
+		size_t remaining = all_indices.size() - first;
+		sorted_indices_.assign(all_indices.begin() + first, all_indices.end());
+
+		size_t num_fit = remaining;
+		if (!PackAtlas(rects.data(), max_size, packers_)) {
+			//lowest always fits, highest never does
+			size_t lowest = 0, highest = remaining;
+			while (highest - lowest > 1) {
+				size_t middle = lowest + (highest - lowest) / 2;
+				sorted_indices_.assign(all_indices.begin() + first, all_indices.begin() + first + middle);
+				if (PackAtlas(rects.data(), max_size, packers_)) {
+					lowest = middle;
+				}
+				else {
+					highest = middle;
+				}
+			}
+			num_fit = lowest;
+		}
+
+		//an image larger than the maximum dimensions can not go on any page
+		if (num_fit == 0) {
+			split = false;
+			break;
+		}
+
+		pages.emplace_back(all_indices.begin() + first, all_indices.begin() + first + num_fit);
+		first += num_fit;
+	}
+
+	heuristic_ = heuristic;
+	max_rects_columns_ = 0;
+	sorted_indices_ = all_indices;
+	return split;
+}
+
+bool AtlasPacker::PackPages(ImageData& image_data, const std::vector<std::vector<int>>& pages, std::vector<Vec2>& page_sizes)
+{
+	if (pages.size() == 1) {
+		if (!PackPage(image_data, image_data.rects_.data())) {
+			return false;
+		}
+		std::fill(image_data.pages_.begin(), image_data.pages_.begin() + image_data.num_images_, 0);
+		page_sizes.push_back(size_);
+		return true;
+	}
+
+	//every page gets its own copy of the packer and of the rects so they can all be packed at once
+	std::vector<AtlasPacker> packers(pages.size(), *this);
+	std::vector<std::vector<Rect>> rects(pages.size(), std::vector<Rect>(image_data.rects_.begin(), image_data.rects_.begin() + image_data.num_images_));
+	std::vector<char> packed(pages.size(), false);
+	int split_columns = MaxRects::GetNumColumns(image_data.rects_.data(), sorted_indices_, max_width_, pixel_padding_, allow_rotation_);
+
+	ThreadPool::Shared().ParallelFor(pages.size(), [&](int page) {
+		AtlasPacker& packer = packers[page];
+		packer.sorted_indices_ = pages[page];
+		packer.stats_.total_images_area = 0;
+		for (int i : pages[page]) {
+			packer.stats_.total_images_area += (long long)image_data.rects_[i].w * image_data.rects_[i].h;
+		}
+		packed[page] = packer.PackPage(image_data, rects[page].data());
+
+		//each page picks its own MaxRects columns for its own images, and the size search might not try the maximum
+		//size. the split already fit the page in the maximum size, so pack it that way again
+		if (!packed[page]) {
+			packer.sorted_indices_ = pages[page];
+			packer.max_rects_columns_ = split_columns;
+			if (packer.heuristic_ == MaxRectsHeuristic::Best) {
+				packer.heuristic_ = MaxRectsHeuristic::BestShortSideFit;
+			}
+			packer.size_ = { max_width_, max_height_ };
+			packed[page] = packer.PackAtlas(rects[page].data(), packer.size_, packer.packers_);
+		}
+	});
+
+	for (int page = 0; page < pages.size(); ++page) {
+		if (!packed[page]) {
+			return false;
+		}
+		for (int i : pages[page]) {
+			image_data.rects_[i] = rects[page][i];
+			image_data.pages_[i] = page;
+		}
+		page_sizes.push_back(packers[page].size_);
+		stats_.rejected_sizes += packers[page].stats_.rejected_sizes;
+		stats_.optimize_runs += packers[page].stats_.optimize_runs;
+		stats_.grid_pages += packers[page].stats_.grid_pages;
+		stats_.grid_blocks += packers[page].stats_.grid_blocks;
+		stats_.proven_pages += packers[page].stats_.proven_pages;
+	}
+
+	return true;
+}
+
+bool AtlasPacker::PackPage(const ImageData& image_data, Rect* rects)
+{
+	if (!use_grids_) {
+		return PackPageSearched(image_data, rects);
+	}
+
+	//pages of several sizes lay out each size with enough images as a block of its own, and pack the blocks with the
+	//rest of the images. if that does not pack, the page is packed one image at a time
+	Vec2 cell;
+	bool same_size = false;
+	if (!GetGridCell(image_data, cell, same_size)) {
+		return PackGridBlocks(image_data, rects) || PackPageSearched(image_data, rects);
+	}
+
+	//no packer fits more images of one size than a grid does, so a grid that fits skips the size search. a small page
+	//of nearly the same sizes is still searched, but only for sizes smaller than the grid. if the grid does not fit,
+	//the packer might still manage
+	std::vector<Rect> grid_rects(rects, rects + image_data.num_images_);
+	if (!PackGrid(image_data, grid_rects.data(), cell)) {
+		return PackPageSearched(image_data, rects);
+	}
+
+	if (!same_size && size_solver_ != SizeSolver::Fixed && sorted_indices_.size() <= MAX_GRID_SEARCH_IMAGES) {
+		Vec2 grid_size = size_;
+		int area_to_beat = area_to_beat_;
+		area_to_beat_ = (int)std::min<long long>(area_to_beat_, (long long)grid_size.x * grid_size.y);
+		bool packed = PackPageSearched(image_data, rects);
+		area_to_beat_ = area_to_beat;
+		if (packed) {
+			return true;
+		}
+		size_ = grid_size;
+	}
+
+	std::copy(grid_rects.begin(), grid_rects.end(), rects);
+	++stats_.grid_pages;
+	return true;
+}
+
+bool AtlasPacker::PackPageSearched(const ImageData& image_data, Rect* rects)
+{
+	if (size_solver_ == SizeSolver::Optimize) {
+		return PackOptimized(image_data, rects);
+	}
+	if (size_solver_ == SizeSolver::Exact) {
+		return PackExact(image_data, rects);
+	}
+	if (sort_order_ == SortOrder::All) {
+		return PackAllSortOrders(image_data, rects);
+	}
+
+	return algo_ == Algorithm::MaxRects && heuristic_ == MaxRectsHeuristic::Best ? PackBestHeuristic(image_data, rects) : PackSmallestSize(image_data, rects);
+}
+
+bool AtlasPacker::GetGridCell(const ImageData& image_data, Vec2& cell, bool& same_size) const
+{
+	if (sorted_indices_.empty()) {
+		return false;
+	}
+
+	Vec2 smallest = { INT_MAX, INT_MAX };
+	cell = { 0, 0 };
+	for (int i : sorted_indices_) {
+		smallest = { std::min(smallest.x, image_data.rects_[i].w), std::min(smallest.y, image_data.rects_[i].h) };
+		cell = { std::max(cell.x, image_data.rects_[i].w), std::max(cell.y, image_data.rects_[i].h) };
+	}
+
+	//turning some images and not others can beat a grid of long images
+	if (allow_rotation_ && (smallest.x != smallest.y || cell.x != cell.y)) {
+		return false;
+	}
+	if (smallest.x == 0 || smallest.y == 0) {
+		return false;
+	}
+
+	same_size = smallest.x == cell.x && smallest.y == cell.y;
+	if (same_size) {
+		return true;
+	}
+
+	//a grid of nearly the same sizes leaves a little space in every cell, which optimizing should not settle for
+	bool optimizing = size_solver_ == SizeSolver::Optimize || size_solver_ == SizeSolver::Exact;
+	return !optimizing && InGridCell(smallest, cell);
+}
+
+bool AtlasPacker::InGridCell(Vec2 size, Vec2 cell)
+{
+	return size.x <= cell.x && size.y <= cell.y && size.x * GRID_TOLERANCE >= cell.x * (GRID_TOLERANCE - 1) && size.y * GRID_TOLERANCE >= cell.y * (GRID_TOLERANCE - 1);
+}
+
+void AtlasPacker::GetGridBuckets(const ImageData& image_data, std::vector<GridBlock>& buckets, std::vector<int>& loose) const
+{
+	//blocks give up some packing for far fewer images to place. only the best fit search packs the page often enough
+	//for that to pay off, the fixed and fast solvers pack each size once, and optimizing should not settle for it
+	if (size_solver_ != SizeSolver::BestFit) {
+		return;
+	}
+
+	//largest first, so the first size in a bucket is its cell and every size after it is at most as large. the same
+	//sizes end up next to each other, so each new size only has to look for its bucket once
+	std::vector<int> order = sorted_indices_;
+	std::stable_sort(order.begin(), order.end(), [&image_data](int a, int b) {
+		const Rect& ra = image_data.rects_[a];
+		const Rect& rb = image_data.rects_[b];
+		long long area_a = (long long)ra.w * ra.h, area_b = (long long)rb.w * rb.h;
+		return area_a != area_b ? area_a > area_b : ra.w > rb.w;
+	});
+
+	Vec2 last_size = { -1, -1 };
+	int bucket = -1;
+	for (int i : order) {
+		Vec2 size = { image_data.rects_[i].w, image_data.rects_[i].h };
+		if (size.x != last_size.x || size.y != last_size.y) {
+			last_size = size;
+			bucket = -1;
+			//turning some images and not others can beat a grid of long images
+			if ((!allow_rotation_ || size.x == size.y) && size.x > 0 && size.y > 0) {
+				for (int b = 0; b < buckets.size() && bucket == -1; ++b) {
+					if (InGridCell(size, buckets[b].cell)) {
+						bucket = b;
+					}
+				}
+				if (bucket == -1) {
+					buckets.push_back({ size });
+					bucket = buckets.size() - 1;
+				}
+			}
+		}
+
+		if (bucket == -1) {
+			loose.push_back(i);
+		}
+		else {
+			buckets[bucket].indices.push_back(i);
+		}
+	}
+
+	long long padded_area = 0;
+	for (int i : sorted_indices_) {
+		padded_area += (long long)(image_data.rects_[i].w + pixel_padding_) * (image_data.rects_[i].h + pixel_padding_);
+	}
+	double atlas_width = std::sqrt((double)padded_area);
+
+	//sizes with too few images to be worth a block, or to fill a row across a square atlas of the page, are packed one
+	//by one. small images pack tightly among the others, and blocks of them only leave gaps
+	int in_blocks = 0;
+	for (int b = 0; b < buckets.size();) {
+		int num_images = buckets[b].indices.size();
+		if (num_images < MIN_GRID_BLOCK_IMAGES || (double)num_images * (buckets[b].cell.x + pixel_padding_) < atlas_width) {
+			loose.insert(loose.end(), buckets[b].indices.begin(), buckets[b].indices.end());
+			buckets.erase(buckets.begin() + b);
+		}
+		else {
+			in_blocks += num_images;
+			++b;
+		}
+	}
+
+	//a few blocks among many loose images save little packing and make the search harder
+	if (in_blocks * MIN_GRID_BLOCK_SHARE < sorted_indices_.size()) {
+		for (const GridBlock& bucket : buckets) {
+			loose.insert(loose.end(), bucket.indices.begin(), bucket.indices.end());
+		}
+		buckets.clear();
+	}
+}
+
+bool AtlasPacker::PackGridBlocks(const ImageData& image_data, Rect* rects)
+{
+	std::vector<GridBlock> buckets;
+	std::vector<int> loose;
+	GetGridBuckets(image_data, buckets, loose);
+	if (buckets.empty()) {
+		return false;
+	}
+
+	//the atlas is at least as wide as a square of the padded images
+	long long padded_area = 0;
+	for (int i : sorted_indices_) {
+		padded_area += (long long)(image_data.rects_[i].w + pixel_padding_) * (image_data.rects_[i].h + pixel_padding_);
+	}
+	int atlas_width = (int)std::sqrt((double)padded_area);
+
+	//blocks of the same width stack into columns, so every fraction of the atlas width is packed on its own copy of the
+	//packer and of the rects at once. smallest atlas wins, ties go to the wider blocks
+	std::vector<AtlasPacker> packers(GRID_BLOCK_SPLITS, *this);
+	std::vector<std::vector<Rect>> split_rects(GRID_BLOCK_SPLITS, std::vector<Rect>(rects, rects + image_data.num_images_));
+	std::vector<char> packed(GRID_BLOCK_SPLITS, false);
+
+	ThreadPool::Shared().ParallelFor(GRID_BLOCK_SPLITS, [&](int i) {
+		packers[i].stats_.rejected_sizes = 0;
+		packers[i].stats_.grid_blocks = 0;
+		packed[i] = packers[i].PackGridBlocks(split_rects[i].data(), buckets, loose, atlas_width / (i + 1));
+	});
+
+	for (const AtlasPacker& packer : packers) {
+		stats_.rejected_sizes += packer.stats_.rejected_sizes;
+	}
+
+	int best = -1;
+	for (int i = 0; i < GRID_BLOCK_SPLITS; ++i) {
+		if (packed[i] && (best == -1 || (long long)packers[i].size_.x * packers[i].size_.y < (long long)packers[best].size_.x * packers[best].size_.y)) {
+			best = i;
+		}
+	}
+
+	if (best == -1) {
+		return false;
+	}
+
+	size_ = packers[best].size_;
+	stats_.grid_blocks += packers[best].stats_.grid_blocks;
+	std::copy(split_rects[best].begin(), split_rects[best].end(), rects);
+	return true;
+}
+
+bool AtlasPacker::PackGridBlocks(Rect* rects, const std::vector<GridBlock>& buckets, std::vector<int> loose, int width)
+{
+	//every bucket is laid out in whole rows of about the width. if the images left over make a block of their own, they
+	//are laid out in a single row, the rest are packed one by one
+	std::vector<GridBlock> blocks;
+	for (const GridBlock& bucket : buckets) {
+		Vec2 padded_cell = { bucket.cell.x + pixel_padding_, bucket.cell.y + pixel_padding_ };
+		int num_images = bucket.indices.size();
+		int max_columns = (max_width_ + pixel_padding_) / padded_cell.x;
+		int max_rows = (max_height_ + pixel_padding_) / padded_cell.y;
+		int columns = std::clamp((width + pixel_padding_) / padded_cell.x, 1, std::max(std::min(num_images, max_columns), 1));
+
+		int first = 0;
+		while (max_columns > 0 && max_rows > 0 && num_images - first >= MIN_GRID_BLOCK_IMAGES) {
+			int block_columns = std::min(columns, num_images - first);
+			int rows = std::min((num_images - first) / block_columns, max_rows);
+			blocks.push_back({ bucket.cell, std::vector<int>(bucket.indices.begin() + first, bucket.indices.begin() + first + rows * block_columns), block_columns });
+			first += rows * block_columns;
+		}
+		loose.insert(loose.end(), bucket.indices.begin() + first, bucket.indices.end());
+	}
+
+	//the loose images, then every block as an image of its own
+	ImageData parts;
+	for (int i : loose) {
+		parts.AddImage("", rects[i].w, rects[i].h);
+	}
+	for (const GridBlock& block : blocks) {
+		int rows = block.indices.size() / block.columns;
+		parts.AddImage("", block.columns * (block.cell.x + pixel_padding_) - pixel_padding_, rows * (block.cell.y + pixel_padding_) - pixel_padding_);
+	}
+
+	sorted_indices_ = GetSortedIndices(parts);
+	stats_.total_images_area = 0;
+	for (const Rect& part : parts.rects_) {
+		stats_.total_images_area += (long long)part.w * part.h;
+	}
+	if (!PackPageSearched(parts, parts.rects_.data())) {
+		return false;
+	}
+
+	for (int i = 0; i < loose.size(); ++i) {
+		rects[loose[i]].x = parts.rects_[i].x;
+		rects[loose[i]].y = parts.rects_[i].y;
+		rects[loose[i]].rotated = parts.rects_[i].rotated;
+	}
+
+	for (int b = 0; b < blocks.size(); ++b) {
+		const GridBlock& block = blocks[b];
+		const Rect& part = parts.rects_[loose.size() + b];
+		Vec2 padded_cell = { block.cell.x + pixel_padding_, block.cell.y + pixel_padding_ };
+		int rows = block.indices.size() / block.columns;
+		for (int i = 0; i < block.indices.size(); ++i) {
+			int column = i % block.columns;
+			int row = i / block.columns;
+			//a turned block turns every cell in it clockwise, so its rows become columns counted from the right
+			Rect& rect = rects[block.indices[i]];
+			rect.x = part.x + (part.rotated ? (rows - 1 - row) * padded_cell.y : column * padded_cell.x);
+			rect.y = part.y + (part.rotated ? column * padded_cell.x : row * padded_cell.y);
+			rect.rotated = part.rotated;
+		}
+	}
+
+	stats_.grid_blocks = blocks.size();
+	return true;
+}
+
+bool AtlasPacker::PackGrid(const ImageData& image_data, Rect* rects, Vec2 cell)
+{
+	//without turning, no layout of same sized images holds more than the columns times the rows that fit
+	int num_images = sorted_indices_.size();
+	Vec2 padded_cell = { cell.x + pixel_padding_, cell.y + pixel_padding_ };
+	auto capacity = [this, padded_cell](Vec2 size) {
+		return (long long)((size.x + pixel_padding_) / padded_cell.x) * ((size.y + pixel_padding_) / padded_cell.y);
+	};
+
+	if (size_solver_ != SizeSolver::Fixed && size_solver_ != SizeSolver::Fast && !force_square_ && !pow_of_2_) {
+		//the narrowest atlas with each number of columns. the smallest area wins, ties go to the squarer atlas
+		Vec2 best = { 0, 0 };
+		for (int columns = 1; columns <= num_images; ++columns) {
+			int rows = (num_images + columns - 1) / columns;
+			Vec2 size = { columns * padded_cell.x - pixel_padding_, rows * padded_cell.y - pixel_padding_ };
+			if (size.x > max_width_) {
+				break;
+			}
+			if (size.y > max_height_) {
+				continue;
+			}
+
+			long long area = (long long)size.x * size.y;
+			long long best_area = (long long)best.x * best.y;
+			if (best.x == 0 || area < best_area || (area == best_area && std::max(size.x, size.y) < std::max(best.x, best.y))) {
+				best = size;
+			}
+		}
+
+		if (best.x == 0 || (long long)best.x * best.y >= area_to_beat_) {
+			return false;
+		}
+		size_ = best;
+	}
+	else {
+		//the other solvers only allow certain sizes, so take the first of those the grid fits in, without packing any
+		if (!GetPossibleContainers(image_data, possible_sizes_)) {
+			return false;
+		}
+		max_size_area_ = area_to_beat_;
+		while (capacity(size_) < num_images) {
+			if (!NextPossibleSize()) {
+				possible_sizes_.clear();
+				return false;
+			}
+		}
+		possible_sizes_.clear();
+	}
+
+	int columns = (size_.x + pixel_padding_) / padded_cell.x;
+	for (int i = 0; i < num_images; ++i) {
+		Rect& rect = rects[sorted_indices_[i]];
+		rect.x = (i % columns) * padded_cell.x;
+		rect.y = (i / columns) * padded_cell.y;
+		rect.rotated = false;
+	}
+
+	return true;
+}
 
+bool AtlasPacker::PackSmallestSize(const ImageData& image_data, Rect* rects)
+{
 	//Get heap of all possible sizes sorted by ascending area. If size solver is best fit and neither force square or power of 2, instead of storing all possible combinations, 
 	//only store all possible heights with a minimum width. After each iteration, increase the width by 1 and push back into heap. Greatly reducing space complexity.
-	GetPossibleContainers(image_data, possible_sizes_);
-	sorted_indices_ = GetSortedIndices(image_data);
+	if (!GetPossibleContainers(image_data, possible_sizes_)) {
+		return false;
+	}
+	max_size_area_ = area_to_beat_;
+
+	//squares and powers of two leave few enough sizes to try them all
+	if (size_solver_ == SizeSolver::BestFit && !force_square_ && !pow_of_2_) {
+		return PackSearchedSize(rects, image_data.num_images_);
+	}
+
+	return PackPossibleSizes(rects, image_data.num_images_);
+}
+
+bool AtlasPacker::PackPossibleSizes(Rect* rects, int num_rects)
+{
+	if (size_.x * size_.y >= max_size_area_) {
+		return false;
+	}
+
+	if (num_parallel_sizes_ > 1) {
+		return PackPossibleSizesParallel(rects, num_rects);
+	}
+
+	//the packers check whether the next size only grew taller and carry on where the last attempt failed if so
+	bool packed = PackAtlas(rects, size_, packers_);
+	while (!packed) {
+		if (PastDeadline() || !NextPossibleSize()) {
+			return false;
+		}
+		packed = ResumeAtlas(rects, size_, packers_);
+	}
+
+	return true;
+}
+
+bool AtlasPacker::PackSearchedSize(Rect* rects, int num_rects)
+{
+	//every candidate height searches for the narrowest width it packs in. packing is nearly monotone, so a size that
+	//fails means narrower widths at that height and that width at shorter heights fail too, and a size that packs means
+	//that width packs at taller heights too. the height that could still give the smallest area is always searched
+	//next, so the first time it packs at its lowest possible width, no other height can beat it
+	struct HeightSearch
+	{
+		int height = 0;
+		int lowest = 0;
+		//narrowest width known to pack. max_width_ + 1 if none is known yet
+		int highest = 0;
+		int step = 1;
+	};
+
+	std::vector<Vec2> all_sizes = possible_sizes_;
+	all_sizes.push_back(size_);
+
+	std::vector<HeightSearch> searches;
+	for (Vec2 size : all_sizes) {
+		searches.push_back({ size.y, size.x, max_width_ + 1, 1 });
+	}
+	std::sort(searches.begin(), searches.end(), [](const HeightSearch& a, const HeightSearch& b) { return a.height < b.height; });
+
+	auto lowest_area = [&searches](int i) { return (long long)searches[i].lowest * searches[i].height; };
+
+	using QueueEntry = std::pair<long long, int>;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+	for (int i = 0; i < searches.size(); ++i) {
+		queue.push({ lowest_area(i), i });
+	}
+
+	//smallest size packed before the search finished, kept in case the deadline passes first
+	Vec2 best_size = { 0, 0 };
+	std::vector<Rect> best_rects;
+
+	bool packed = false;
+	bool first_pack = true;
+	while (!queue.empty() && !packed && !PastDeadline()) {
+		auto [area, i] = queue.top();
+		queue.pop();
+
+		//entries only go stale by growing, so nothing left in the queue is smaller
+		if (area >= max_size_area_) {
+			break;
+		}
+
+		HeightSearch& search = searches[i];
+		if (search.lowest > max_width_) {
+			continue;
+		}
+		//another height has raised the lowest width since this was queued
+		if (lowest_area(i) != area) {
+			queue.push({ lowest_area(i), i });
+			continue;
+		}
+		//images that do not pack monotonically can leave a known packing width below the lowest, start that over
+		if (search.lowest > search.highest) {
+			search.highest = max_width_ + 1;
+		}
+
+		//gallop up from the lowest width until one packs, then binary search back down
+		int width = 0;
+		if (search.highest > max_width_) {
+			width = std::min(search.lowest + search.step - 1, max_width_);
+			search.step *= 2;
+		}
+		else {
+			width = search.lowest + (search.highest - search.lowest) / 2;
+		}
+
+		bool fits_bounds = bounds_.Fits({ width, search.height });
+		stats_.rejected_sizes += !fits_bounds;
+		bool size_packed = false;
+		if (fits_bounds) {
+			//packers carry on from the last failed size if this one is just as wide, which happens when the heights
+			//searched one after another land on the same width
+			size_packed = first_pack ? PackAtlas(rects, { width, search.height }, packers_) : ResumeAtlas(rects, { width, search.height }, packers_);
+			first_pack = false;
+		}
+
+		if (size_packed) {
+			size_ = { width, search.height };
+			packed = width == search.lowest;
+			long long packed_area = (long long)width * search.height;
+			if (!packed && packed_area < max_size_area_ && (best_size.x == 0 || packed_area < (long long)best_size.x * best_size.y)) {
+				best_size = size_;
+				best_rects.assign(rects, rects + num_rects);
+			}
+			for (int j = i; j < searches.size(); ++j) {
+				searches[j].highest = std::min(searches[j].highest, width);
+			}
+		}
+		else {
+			for (int j = 0; j < searches.size() && searches[j].height <= search.height; ++j) {
+				searches[j].lowest = std::max(searches[j].lowest, width + 1);
+			}
+		}
+
+		queue.push({ lowest_area(i), i });
+	}
+
+	//the search ran out of time before it proved a size smallest, so settle for the smallest that packed
+	if (!packed && best_size.x > 0) {
+		size_ = best_size;
+		std::copy(best_rects.begin(), best_rects.end(), rects);
+		return true;
+	}
+
+	if (!packed || !verify_size_) {
+		return packed;
+	}
 
-	while (!PackAtlas(image_data, size_)) {
+	//try every smaller size one pixel at a time, in case the images do not pack monotonically
+	Vec2 searched_size = size_;
+	std::vector<Rect> searched_rects(rects, rects + num_rects);
+
+	possible_sizes_ = all_sizes;
+	std::make_heap(possible_sizes_.begin(), possible_sizes_.end(), [](Vec2 a, Vec2 b) { return a.x * a.y > b.x * b.y; });
+	std::pop_heap(possible_sizes_.begin(), possible_sizes_.end(), [](Vec2 a, Vec2 b) { return a.x * a.y > b.x * b.y; });
+	size_ = possible_sizes_.back();
+	possible_sizes_.pop_back();
+
+	max_size_area_ = searched_size.x * searched_size.y;
+	if (!PackPossibleSizes(rects, num_rects)) {
+		size_ = searched_size;
+		std::copy(searched_rects.begin(), searched_rects.end(), rects);
+	}
+
+	return true;
+}
+
+bool AtlasPacker::PackBestHeuristic(const ImageData& image_data, Rect* rects)
+{
+	//every heuristic gets its own copy of the packer and of the rects so they can all run at once
+	std::vector<AtlasPacker> packers(NUM_MAX_RECTS_HEURISTICS, *this);
+	std::vector<std::vector<Rect>> heuristic_rects(NUM_MAX_RECTS_HEURISTICS, std::vector<Rect>(rects, rects + image_data.num_images_));
+	std::vector<char> packed(NUM_MAX_RECTS_HEURISTICS, false);
+
+	ThreadPool::Shared().ParallelFor(NUM_MAX_RECTS_HEURISTICS, [&](int i) {
+		packers[i].heuristic_ = (MaxRectsHeuristic)i;
+		packers[i].stats_.rejected_sizes = 0;
+		packed[i] = packers[i].PackSmallestSize(image_data, heuristic_rects[i].data());
+	});
+
+	for (const AtlasPacker& packer : packers) {
+		stats_.rejected_sizes += packer.stats_.rejected_sizes;
+	}
+
+	//smallest atlas wins, ties go to the heuristic listed first
+	int best = -1;
+	for (int i = 0; i < NUM_MAX_RECTS_HEURISTICS; ++i) {
+		if (packed[i] && (best == -1 || packers[i].size_.x * packers[i].size_.y < packers[best].size_.x * packers[best].size_.y)) {
+			best = i;
+		}
+	}
+
+	if (best == -1) {
+		return false;
+	}
+
+	size_ = packers[best].size_;
+	std::copy(heuristic_rects[best].begin(), heuristic_rects[best].end(), rects);
+	return true;
+}
+
+bool AtlasPacker::PackAllSortOrders(const ImageData& image_data, Rect* rects)
+{
+	//every order gets its own copy of the packer and of the rects so they can all run at once
+	std::vector<AtlasPacker> packers(NUM_SORT_ORDERS, *this);
+	std::vector<std::vector<Rect>> order_rects(NUM_SORT_ORDERS, std::vector<Rect>(rects, rects + image_data.num_images_));
+	std::vector<char> packed(NUM_SORT_ORDERS, false);
+
+	ThreadPool::Shared().ParallelFor(NUM_SORT_ORDERS, [&](int i) {
+		packers[i].sort_order_ = (SortOrder)i;
+		packers[i].SortPage(image_data);
+		packers[i].stats_.rejected_sizes = 0;
+		packed[i] = packers[i].PackPageSearched(image_data, order_rects[i].data());
+	});
+
+	for (const AtlasPacker& packer : packers) {
+		stats_.rejected_sizes += packer.stats_.rejected_sizes;
+	}
+
+	//smallest atlas wins, ties go to the order listed first
+	int best = -1;
+	for (int i = 0; i < NUM_SORT_ORDERS; ++i) {
+		if (packed[i] && (best == -1 || packers[i].size_.x * packers[i].size_.y < packers[best].size_.x * packers[best].size_.y)) {
+			best = i;
+		}
+	}
+
+	if (best == -1) {
+		return false;
+	}
+
+	size_ = packers[best].size_;
+	std::copy(order_rects[best].begin(), order_rects[best].end(), rects);
+	return true;
+}
+
+bool AtlasPacker::PackOptimized(const ImageData& image_data, Rect* rects)
+{
+	//the fast solver only packs a few sizes, so its atlas is there to keep however soon the time budget runs out
+	std::vector<Rect> best_rects(rects, rects + image_data.num_images_);
+	Vec2 best_size;
+	if (!PackFloor(image_data, best_rects.data(), best_size)) {
+		best_rects.clear();
+	}
+
+	//every thread packs one run at a time until the time budget runs out. runs that are cut short keep the smallest size
+	//they packed. smallest atlas wins and ties go to the earlier run, so the same runs always give the same atlas
+	int batch_size = ThreadPool::Shared().NumThreads();
+	std::vector<AtlasPacker> packers(batch_size);
+	std::vector<std::vector<Rect>> run_rects(batch_size);
+	std::vector<char> packed(batch_size, false);
+	std::vector<char> finished(batch_size, false);
+
+	for (int first_run = 0; !PastDeadline(); first_run += batch_size) {
+		ThreadPool::Shared().ParallelFor(batch_size, [&](int i) {
+			int run = first_run + i;
+			packers[i] = *this;
+			packers[i].area_to_beat_ = best_rects.empty() ? INT_MAX : best_size.x * best_size.y;
+			SetupOptimizeRun(image_data, packers[i], run);
+			run_rects[i].assign(rects, rects + image_data.num_images_);
+			packed[i] = !packers[i].PastDeadline() && packers[i].PackPageSearched(image_data, run_rects[i].data());
+			//runs that could not beat the best area give up early too, they just did not run out of time
+			finished[i] = !packers[i].PastDeadline();
+		});
+
+		for (int i = 0; i < batch_size; ++i) {
+			stats_.rejected_sizes += packers[i].stats_.rejected_sizes;
+			stats_.optimize_runs += finished[i];
+			if (!packed[i]) {
+				continue;
+			}
+
+			if (best_rects.empty() || packers[i].size_.x * packers[i].size_.y < best_size.x * best_size.y) {
+				best_size = packers[i].size_;
+				best_rects = run_rects[i];
+			}
+		}
+	}
+
+	if (best_rects.empty()) {
+		return false;
+	}
+
+	size_ = best_size;
+	std::copy(best_rects.begin(), best_rects.end(), rects);
+	return true;
+}
+
+bool AtlasPacker::PackExact(const ImageData& image_data, Rect* rects)
+{
+	//a fast packing is kept if nothing smaller is found in time. the best MaxRects packing is then searched for while
+	//time remains, and is the size to beat
+	AtlasPacker floor = *this;
+	floor.algo_ = Algorithm::MaxRects;
+	floor.heuristic_ = MaxRectsHeuristic::BestShortSideFit;
+	if (exact_width_ > 0) {
+		floor.max_width_ = std::min(exact_width_, max_width_);
+	}
+	floor.SortPage(image_data);
+	Vec2 floor_size;
+	floor.stats_.rejected_sizes = 0;
+	bool packed = floor.PackFloor(image_data, rects, floor_size);
+	stats_.rejected_sizes += floor.stats_.rejected_sizes;
+	if (!packed) {
+		return false;
+	}
+
+	//the fast sizes are square or the maximum size, so at a fixed width the atlas is only as tall as the images reach
+	if (exact_width_ > 0) {
+		floor_size.x = floor.max_width_;
+		if (!force_square_ && !pow_of_2_) {
+			floor_size.y = 0;
+			for (int i : sorted_indices_) {
+				floor_size.y = std::max(floor_size.y, rects[i].y + (rects[i].rotated ? rects[i].w : rects[i].h));
+			}
+		}
+	}
+	size_ = floor_size;
 
+	AtlasPacker fallback = floor;
+	fallback.size_solver_ = SizeSolver::BestFit;
+	fallback.heuristic_ = MaxRectsHeuristic::Best;
+	fallback.area_to_beat_ = (int)std::min<long long>(area_to_beat_, (long long)size_.x * size_.y);
+	fallback.stats_.rejected_sizes = 0;
+
+	std::vector<Rect> fallback_rects(rects, rects + image_data.num_images_);
+	packed = fallback.PackPageSearched(image_data, fallback_rects.data());
+	stats_.rejected_sizes += fallback.stats_.rejected_sizes;
+	Vec2 fallback_size = exact_width_ > 0 ? Vec2{ fallback.max_width_, fallback.size_.y } : fallback.size_;
+	if (packed && (long long)fallback_size.x * fallback_size.y < (long long)size_.x * size_.y) {
+		size_ = fallback_size;
+		std::copy(fallback_rects.begin(), fallback_rects.end(), rects);
+	}
+
+	if (sorted_indices_.size() > MAX_EXACT_IMAGES) {
+		return true;
+	}
+
+	//images that do not fit a size do not fit any shorter one either, so each width only needs its tallest height below
+	//some area. searches take far longer the more room is left over, so that area starts at the area of the images and
+	//grows a step at a time until it reaches the best area found. a packing that is found shrinks to the space it uses
+	bounds_ = SizeBounds(image_data, sorted_indices_, pixel_padding_, allow_rotation_);
+	BranchAndBound exact;
+	std::vector<Rect> exact_rects(rects, rects + image_data.num_images_);
+	int first_width = exact_width_ > 0 ? size_.x : 1;
+	int last_width = exact_width_ > 0 ? size_.x : force_square_ ? std::min(max_width_, max_height_) : max_width_;
+	//tallest height known not to fit at each width
+	std::vector<int> failed_heights(last_width + 1, 0);
+
+	long long area_step = std::max<long long>(stats_.total_images_area / EXACT_AREA_STEPS, 1);
+	for (long long area = stats_.total_images_area; ; area += area_step) {
+		for (int w = first_width; w <= last_width; pow_of_2_ ? w *= 2 : ++w) {
+			while (true) {
+				long long below = std::min(area, (long long)size_.x * size_.y - 1);
+				int h = (int)std::min<long long>(below / w, max_height_);
+				if (force_square_) {
+					h = w * (long long)w <= below ? w : 0;
+				}
+				else if (pow_of_2_) {
+					while (h > 0 && (h & (h - 1)) != 0) {
+						h &= h - 1;
+					}
+				}
+
+				if (h <= failed_heights[w]) {
+					break;
+				}
+				if (!bounds_.Fits({ w, h })) {
+					++stats_.rejected_sizes;
+					failed_heights[w] = h;
+					break;
+				}
+				if (!exact.PackAtlas(exact_rects.data(), { w, h }, sorted_indices_, pixel_padding_, allow_rotation_, deadline_)) {
+					//running out of time keeps the best packing so far, without proving it
+					if (exact.TimedOut()) {
+						return true;
+					}
+					failed_heights[w] = h;
+					break;
+				}
+
+				Vec2 used = { 0, 0 };
+				for (int i : sorted_indices_) {
+					const Rect& rect = exact_rects[i];
+					used.x = std::max(used.x, rect.x + (rect.rotated ? rect.h : rect.w));
+					used.y = std::max(used.y, rect.y + (rect.rotated ? rect.w : rect.h));
+				}
+				if (exact_width_ > 0 || force_square_ || pow_of_2_) {
+					used.x = w;
+				}
+				if (force_square_ || pow_of_2_) {
+					used.y = h;
+				}
+
+				size_ = used;
+				std::copy(exact_rects.begin(), exact_rects.end(), rects);
+			}
+		}
+
+		//every width has now been tried below the best area, which is then the smallest
+		if (area >= (long long)size_.x * size_.y - 1) {
+			break;
+		}
+	}
+
+	++stats_.proven_pages;
+	return true;
+}
+
+void AtlasPacker::SetupOptimizeRun(const ImageData& image_data, AtlasPacker& packer, int run) const
+{
+	packer.size_solver_ = SizeSolver::BestFit;
+	packer.num_parallel_sizes_ = 1;
+	packer.stats_.rejected_sizes = 0;
+
+	//run 0 is best fit with the configured settings, so unless time runs out first optimizing is never worse than that
+	if (run == 0) {
+		return;
+	}
+
+	//every config packs in height order first, then each of the other orders
+	int combination = (run - 1) % (NUM_OPTIMIZE_CONFIGS * NUM_SORT_ORDERS);
+	const OptimizeConfig& config = OPTIMIZE_CONFIGS[combination % NUM_OPTIMIZE_CONFIGS];
+	packer.algo_ = config.algo;
+	packer.heuristic_ = config.heuristic;
+	packer.guillotine_split_ = config.split;
+	packer.sort_order_ = (SortOrder)(combination / NUM_OPTIMIZE_CONFIGS);
+	packer.SortPage(image_data);
+
+	//after every combination has packed once, each run jitters the order. images mostly stay near their place, so the
+	//largest still go first
+	if (run > NUM_OPTIMIZE_CONFIGS * NUM_SORT_ORDERS) {
+		std::vector<int>& page_indices = packer.sorted_indices_;
+		std::mt19937 rng(run);
+		float strength = std::uniform_real_distribution<float>(0.02f, 0.3f)(rng) * page_indices.size();
+		std::uniform_real_distribution<float> jitter(0.0f, strength);
+
+		std::vector<std::pair<float, int>> keys;
+		for (int i = 0; i < page_indices.size(); ++i) {
+			keys.push_back({ i + jitter(rng), page_indices[i] });
+		}
+		std::sort(keys.begin(), keys.end());
+		for (int i = 0; i < keys.size(); ++i) {
+			page_indices[i] = keys[i].second;
+		}
+	}
+}
+
+bool AtlasPacker::PackFloor(const ImageData& image_data, Rect* rects, Vec2& size)
+{
+	AtlasPacker floor = *this;
+	floor.size_solver_ = SizeSolver::Fast;
+	floor.deadline_ = std::chrono::steady_clock::time_point::max();
+	floor.num_parallel_sizes_ = 1;
+	floor.stats_.rejected_sizes = 0;
+	bool packed = floor.PackPageSearched(image_data, rects);
+
+	//the fast sizes are all close to square, which a narrow maximum size can rule out
+	if (!packed) {
+		floor.size_solver_ = SizeSolver::Fixed;
+		floor.possible_sizes_.clear();
+		packed = floor.PackPageSearched(image_data, rects);
+	}
+
+	stats_.rejected_sizes += floor.stats_.rejected_sizes;
+	size = floor.size_;
+	return packed;
+}
+
+bool AtlasPacker::PastDeadline() const
+{
+	return deadline_ != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline_;
+}
+
+bool AtlasPacker::NextPossibleSize()
+{
+	//sizes the bounds rule out are stepped past without returning them to be packed
+	while (true) {
 		//increase width and push back into heap
 		if (size_solver_ == SizeSolver::BestFit && !force_square_ && !pow_of_2_) {
 			++size_.x;
@@ -62,29 +1241,70 @@ int AtlasPacker::CreateAtlas(ImageData& image_data)
 		}
 
 		if (possible_sizes_.empty()) {
-			return -1;
+			return false;
 		}
 		//pop next smallest area
 		std::pop_heap(possible_sizes_.begin(), possible_sizes_.end(), [](Vec2 a, Vec2 b) { return a.x * a.y > b.x * b.y; });
 		size_ = possible_sizes_.back();
 		possible_sizes_.pop_back();
+
+		if (size_.x * size_.y >= max_size_area_) {
+			return false;
+		}
+		if (bounds_.Fits(size_)) {
+			return true;
+		}
+		++stats_.rejected_sizes;
 	}
+}
 
-	std::chrono::steady_clock::time_point end_time = std::chrono::high_resolution_clock::now();
-	stats_.time_elapsed_in_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
-	stats_.atlas_area = size_.x * size_.y;
-	stats_.unused_area = stats_.atlas_area - stats_.total_images_area;
-	stats_.packing_efficiency = (stats_.total_images_area / (float)stats_.atlas_area) * 100;
+bool AtlasPacker::PackPossibleSizesParallel(Rect* rects, int num_rects)
+{
+	while (attempts_.size() < (size_t)num_parallel_sizes_) {
+		attempts_.emplace_back();
+	}
 
-	//contains x, y, w, h of all individual textures in atlas
-	metadata_ = GetAtlasMetadata(image_data);
+	while (true) {
+		//take the next sizes in the exact order the serial solver would try them if each one failed.
+		//the first size in that order to succeed is then the same size the serial solver would have stopped at
+		int num_attempts = 0;
+		bool sizes_left = true;
+		do {
+			PackAttempt& attempt = attempts_[num_attempts++];
+			attempt.size = size_;
+			attempt.packed = false;
+			attempt.cancelled = false;
+			attempt.rects.assign(rects, rects + num_rects);
+		} while (num_attempts < num_parallel_sizes_ && (sizes_left = NextPossibleSize()));
 
-	WriteAtlasImageData(image_data, size_.x, size_.y);
+		ThreadPool::Shared().ParallelFor(num_attempts, [this, num_attempts](int i) {
+			PackAttempt& attempt = attempts_[i];
+			if (attempt.cancelled) {
+				return;
+			}
 
-	possible_sizes_.clear();
-	size_ = { 0,0 };
+			attempt.packed = PackAtlas(attempt.rects.data(), attempt.size, attempt.packers, &attempt.cancelled);
+
+			//anything larger than a successful size is no longer needed
+			if (attempt.packed) {
+				for (int j = i + 1; j < num_attempts; ++j) {
+					attempts_[j].cancelled = true;
+				}
+			}
+		});
+
+		for (int i = 0; i < num_attempts; ++i) {
+			if (attempts_[i].packed) {
+				size_ = attempts_[i].size;
+				std::copy(attempts_[i].rects.begin(), attempts_[i].rects.end(), rects);
+				return true;
+			}
+		}
 
-	return image_data.num_images_;
+		if (!sizes_left || !NextPossibleSize()) {
+			return false;
+		}
+	}
 }
 
 std::string AtlasPacker::GetAtlasMetadata(const ImageData& images)
@@ -95,49 +1315,43 @@ std::string AtlasPacker::GetAtlasMetadata(const ImageData& images)
 		data << "x pos: " << images.rects_[i].x << ", ";
 		data << "y pos: " << images.rects_[i].y << ", ";
 		data << "width: " << images.rects_[i].w << ", ";
-		data << "height: " << images.rects_[i].h << "\n";
+		data << "height: " << images.rects_[i].h;
+		if (allow_rotation_) {
+			data << ", rotated: " << images.rects_[i].rotated;
+		}
+		if (multi_page_) {
+			data << ", page: " << images.pages_[i];
+		}
+		data << "\n";
 	}
 
 	return data.str();
 }
 
-bool AtlasPacker::PackAtlas(ImageData& images, Vec2 size)
+bool AtlasPacker::PackAtlas(Rect* rects, Vec2 size, Packers& packers, const std::atomic<bool>* cancelled)
 {
-	return algo_ == Algorithm::Shelf ? PackAtlasShelf(images, size) : MaxRects::PackAtlas(images, size, sorted_indices_, pixel_padding_);
+	switch (algo_) {
+		case Algorithm::MaxRects: return packers.max_rects.PackAtlas(rects, size, sorted_indices_, pixel_padding_, heuristic_, allow_rotation_, max_rects_columns_, cancelled);
+		case Algorithm::Skyline: return packers.skyline.PackAtlas(rects, size, sorted_indices_, pixel_padding_, allow_rotation_, cancelled);
+		case Algorithm::Guillotine: return packers.guillotine.PackAtlas(rects, size, sorted_indices_, pixel_padding_, guillotine_split_, guillotine_merge_, allow_rotation_, cancelled);
+		default: return packers.shelf.PackAtlas(rects, size, sorted_indices_, pixel_padding_, allow_rotation_, shelf_rule_);
+	}
 }
 
-bool AtlasPacker::PackAtlasShelf(ImageData& images, Vec2 size)
+bool AtlasPacker::ResumeAtlas(Rect* rects, Vec2 size, Packers& packers, const std::atomic<bool>* cancelled)
 {
-	int pen_x = 0, pen_y = 0;
-	int next_pen_y = images.rects_[sorted_indices_[0]].h;
-
-	for (int i = 0; i < images.num_images_; ++i) {
-
-		while (pen_x + images.rects_[sorted_indices_[i]].w >= size.x) {
-			pen_x = 0;
-			pen_y += next_pen_y + pixel_padding_;
-			next_pen_y = images.rects_[sorted_indices_[i]].h;
-
-			//unable to fit everything in atlas
-			if (pen_y + images.rects_[sorted_indices_[i]].h >= size.y) {
-				return false;
-			}
-		}
-
-		images.rects_[sorted_indices_[i]].x = pen_x;
-		images.rects_[sorted_indices_[i]].y = pen_y;
-
-		pen_x += images.rects_[sorted_indices_[i]].w + pixel_padding_;
+	switch (algo_) {
+		case Algorithm::MaxRects: return packers.max_rects.ResumeTaller(rects, size, sorted_indices_, pixel_padding_, heuristic_, allow_rotation_, max_rects_columns_, cancelled);
+		case Algorithm::Skyline: return packers.skyline.ResumeTaller(rects, size, sorted_indices_, pixel_padding_, allow_rotation_, cancelled);
+		//stretched free rects change which one has the best area fit, so guillotine always packs from the start
+		case Algorithm::Guillotine: return PackAtlas(rects, size, packers, cancelled);
+		default: return packers.shelf.ResumeTaller(rects, size, sorted_indices_, pixel_padding_, allow_rotation_, shelf_rule_);
 	}
-
-	return true;
 }
 
-void AtlasPacker::GetPossibleContainers(const ImageData& images, std::vector<Vec2>& possible_sizes)
+bool AtlasPacker::GetPossibleContainers(const ImageData& images, std::vector<Vec2>& possible_sizes)
 {
-	for (int i = 0; i < images.num_images_; ++i) {
-		stats_.total_images_area += images.rects_[i].w * images.rects_[i].h;
-	}
+	bounds_ = SizeBounds(images, sorted_indices_, pixel_padding_, allow_rotation_);
 
 	switch (size_solver_) {
 		case SizeSolver::Fixed: { possible_sizes_.push_back({ max_width_, max_height_ }); break; }
@@ -147,46 +1361,74 @@ void AtlasPacker::GetPossibleContainers(const ImageData& images, std::vector<Vec
 			Vec2 size{ 32, 32 };
 			while (size.x <= max_width_ && size.y <= max_height_) {
 				
-				size.x == size.y ? (size.x += pow_of_2_ ? size.x : 32) : size.y = size.x;
+				size.x == size.y ? (size.x += pow_of_2_ ? size.x : FAST_SIZE_STEP) : size.y = size.x;
 				if (force_square_) { 
 					size.y = size.x; 
 				}
 
-				if (size.x * size.y > stats_.total_images_area) {
+				//last step can overshoot the maximum dimensions
+				if ((long long)size.x * size.y > stats_.total_images_area && size.x <= max_width_ && size.y <= max_height_) {
 					possible_sizes.push_back(size);
 				}
 			}
 			break;
 		}
 
+		//every optimize run, and the packing the exact solver starts from, switches to best fit before it gets here, so
+		//these only ever see the best fit list
+		case SizeSolver::Optimize:
+		case SizeSolver::Exact:
 		case SizeSolver::BestFit: {
 
 			int min_width = 0;
 			int min_height = 0;
 			int max_height = 0;
-			for (int i = 0; i < images.num_images_; ++i) {
-				if (images.rects_[i].w > min_width) {
-					min_width = images.rects_[i].w;
+			for (int i : sorted_indices_) {
+				//a turned image only needs its short side to fit either way
+				int width = allow_rotation_ ? std::min(images.rects_[i].w, images.rects_[i].h) : images.rects_[i].w;
+				int height = allow_rotation_ ? width : images.rects_[i].h;
+				if (width > min_width) {
+					min_width = width;
 				}
 
 				max_height += images.rects_[i].h;
-				if (images.rects_[i].h > min_height) {
-					min_height = images.rects_[i].h;
+				if (height > min_height) {
+					min_height = height;
 				}
 			}
 			max_height = std::min(max_height, max_height_);
 
 			for (int h = 1; h < max_height;) {
 				if (force_square_){
-					if (h * h > stats_.total_images_area && h >= min_height) {
+					if ((long long)h * h > stats_.total_images_area && h >= min_height) {
 						possible_sizes.push_back({ h, h });
 					}
 				}
 				else{
-					int w = 1;
-					while (w * h < stats_.total_images_area || w < min_width) {
+					//narrowest width at least as wide as the widest image with the area of the images. anything past the
+					//maximum width is as good as any other
+					long long min_area_width = 1;
+					if (pow_of_2_) {
+						while (min_area_width * h < stats_.total_images_area || min_area_width < min_width) {
+							min_area_width *= 2;
+						}
+					}
+					else {
+						min_area_width = std::max({ min_area_width, (stats_.total_images_area + h - 1) / h, (long long)min_width });
+					}
+					int w = (int)std::min(min_area_width, max_width_ + 1LL);
+
+					//start each height past the widths the bounds rule out, instead of packing them one by one
+					int bound_width = !pow_of_2_ && h >= min_height ? bounds_.MinWidth(h) : w;
+					if (bound_width > w) {
+						stats_.rejected_sizes += std::max(std::min(bound_width, max_width_ + 1) - w, 0);
+						w = bound_width;
+					}
+					while (h >= min_height && w <= max_width_ && !bounds_.Fits({ w, h })) {
 						pow_of_2_ ? w *= 2 : ++w;
+						++stats_.rejected_sizes;
 					}
+
 					if (w <= max_width_ && h >= min_height) {
 						possible_sizes.push_back({ w, h });
 					}
@@ -196,23 +1438,69 @@ void AtlasPacker::GetPossibleContainers(const ImageData& images, std::vector<Vec
 		}
 	}
 
+	//pages are split off at the maximum dimensions, so make sure every page can at least go back to them
+	if (multi_page_ && size_solver_ != SizeSolver::Fixed) {
+		possible_sizes.push_back({ max_width_, max_height_ });
+	}
+
+	//sizes the bounds rule out could only fail to pack
+	auto rejected = std::remove_if(possible_sizes.begin(), possible_sizes.end(), [this](Vec2 size) { return !bounds_.Fits(size); });
+	stats_.rejected_sizes += possible_sizes.end() - rejected;
+	possible_sizes.erase(rejected, possible_sizes.end());
+
 	//sort by smallest area and pop smallest fit into size_
 	if (possible_sizes.empty()) {
-		return;
+		return false;
 	}
 
 	std::make_heap(possible_sizes.begin(), possible_sizes.end(), [](Vec2 a, Vec2 b) { return a.x * a.y > b.x * b.y; });
 	std::pop_heap(possible_sizes.begin(), possible_sizes.end(), [](Vec2 a, Vec2 b) { return a.x * a.y > b.x * b.y; });
 	size_ = possible_sizes.back();
 	possible_sizes.pop_back();
+	return true;
 }
 
 //sort image data without affected underlying structure
 std::vector<int> AtlasPacker::GetSortedIndices(const ImageData& images)
 {
+	//with rotation the height depends on how each image is placed. level based packers sort by the short side every image
+	//can lie on, free rect packers place the longest images first while there is still room to turn them
+	bool level_based = algo_ == Algorithm::Shelf || algo_ == Algorithm::Skyline;
+
+	//keys are worked out once up front and sorted alongside their index, instead of looked up through the index in
+	//every comparison
+	std::vector<std::pair<double, int>> keys(images.num_images_);
+	for (int i = 0; i < images.num_images_; ++i) {
+		int w = images.rects_[i].w;
+		int h = images.rects_[i].h;
+		double key = 0.0;
+		switch (sort_order_) {
+			case SortOrder::Width: key = allow_rotation_ ? (level_based ? std::min(w, h) : std::max(w, h)) : w; break;
+			case SortOrder::Area: key = (double)w * h; break;
+			case SortOrder::Perimeter: key = w + h; break;
+			case SortOrder::MaxSide: key = std::max(w, h); break;
+			case SortOrder::Ratio: key = std::max(w, h) / (double)std::max(std::min(w, h), 1); break;
+			//all packs each order on a copy, the pages are split off by height
+			default: key = allow_rotation_ ? (level_based ? std::min(w, h) : std::max(w, h)) : h; break;
+		}
+		keys[i] = { key, i };
+	}
+	std::sort(keys.begin(), keys.end(), [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first > b.first; });
+
 	std::vector<int> sorted_indices(images.num_images_);
-	std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
-	std::sort(sorted_indices.begin(), sorted_indices.end(), [&images](int i, int j) { return images.rects_[i].h > images.rects_[j].h; });
+	for (int i = 0; i < images.num_images_; ++i) {
+		sorted_indices[i] = keys[i].second;
+	}
 
 	return sorted_indices;
 }
+
+void AtlasPacker::SortPage(const ImageData& images)
+{
+	std::vector<int> order = GetSortedIndices(images);
+	std::vector<int> rank(images.num_images_);
+	for (int i = 0; i < order.size(); ++i) {
+		rank[order[i]] = i;
+	}
+	std::sort(sorted_indices_.begin(), sorted_indices_.end(), [&rank](int a, int b) { return rank[a] < rank[b]; });
+}
@@ -1,45 +1,185 @@
 #pragma once
 
 #include "ImageData.h"
+#include "Bounds.h"
+#include "BranchAndBound.h"
+#include "Guillotine.h"
+#include "MaxRects.h"
+#include "Shelf.h"
+#include "Skyline.h"
 
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <deque>
 #include <unordered_map>
 
 constexpr int MAX_DIMENSIONS = 4096;
+constexpr int MAX_PARALLEL_SIZES = 64;
+//pages with more images than this are too slow to search exactly, so the exact solver keeps its MaxRects packing
+constexpr int MAX_EXACT_IMAGES = 30;
 struct Stats
 {
 	double time_elapsed_in_ms = 0.0;
-	int total_images_area = 0;
-	int atlas_area = 0;
-	int unused_area = 0;
+	long long total_images_area = 0;
+	long long atlas_area = 0;
+	long long unused_area = 0;
 	float packing_efficiency = 0.0f;
+	//candidate sizes the lower bounds ruled out without packing
+	int rejected_sizes = 0;
+	//runs the optimize solver finished within its time budget
+	int optimize_runs = 0;
+	//pages of same sized images laid out as a grid instead of searched for
+	int grid_pages = 0;
+	//blocks of same sized images on pages of several sizes, laid out as a grid and packed as one image with the rest
+	int grid_blocks = 0;
+	//pages the exact solver proved can not be packed any smaller
+	int proven_pages = 0;
+	//simd kernel MaxRects scored short side fits with on this cpu, empty if the short side fit was not used
+	std::string fit_kernel;
+	//algorithm and size solver the auto algorithm picked, and the image statistics it went by
+	std::string auto_choice;
+	std::string auto_reason;
 
 };
 
 enum class Algorithm 
 {
 	Shelf,
-	MaxRects
+	MaxRects,
+	Skyline,
+	Guillotine,
+	//picks one of the above, and between the fast and best fit solvers, from the image sizes
+	Auto
 };
 
 enum class SizeSolver
 {
 	Fixed,
 	Fast,
-	BestFit
+	BestFit,
+	//best fit with many algorithms and sort orders on every core until the time budget runs out
+	Optimize,
+	//searches every packing of smaller sizes than MaxRects finds, until the time budget runs out
+	Exact
+};
+
+//size images are sorted by before packing, largest first
+enum class SortOrder
+{
+	//with rotation, height and width both sort by the side the algorithm turns images on
+	Height,
+	Width,
+	Area,
+	Perimeter,
+	MaxSide,
+	//long side over short side, so the most stretched images go first
+	Ratio,
+	//packs with every order above at the same time and keeps the smallest atlas
+	All
+};
+
+constexpr int NUM_SORT_ORDERS = (int)SortOrder::All;
+
+//packers that keep their lists between attempts. every attempt running at the same time needs its own.
+//every packer, and the exact solver, packs each image with the padding added to its right and bottom edges into an
+//atlas that is padding larger. images always end up at least the padding apart, and the padding after the last image
+//falls outside the real atlas
+struct Packers
+{
+	Shelf shelf;
+	MaxRects max_rects;
+	Skyline skyline;
+	Guillotine guillotine;
+};
+
+//one candidate size being packed on its own copy of the rects when sizes are packed in parallel
+struct PackAttempt
+{
+	Vec2 size;
+	std::vector<Rect> rects;
+	Packers packers;
+	std::atomic<bool> cancelled = false;
+	bool packed = false;
+
+	//attempts are only scratch space, so a copy starts out empty. lets AtlasPacker be copied to pack variants side by side
+	PackAttempt() = default;
+	PackAttempt(const PackAttempt&) {}
+	PackAttempt& operator=(const PackAttempt&) { return *this; }
+};
+
+//images of the same or nearly the same size, largest first, laid out in a grid row by row
+struct GridBlock
+{
+	Vec2 cell;
+	std::vector<int> indices;
+	int columns = 0;
 };
 
 class AtlasPacker
 {
 public:
+	//returns the number of atlas pages created, or -1 if the images could not be packed
 	int CreateAtlas(ImageData& image_data);
+	//same as CreateAtlas without copying any pixels, so only the image sizes are needed. fills in atlas_rects_ and leaves
+	//atlas_data_ empty
+	int CreateLayout(ImageData& image_data);
 	std::string GetAtlasMetadata(const ImageData& images);
+	//sets the quickest algorithm, and size solver if fast or best fit, expected to fill the target share of the atlas
+	void ChooseAlgorithm(const ImageData& image_data);
+	//share of the rows that shelves of images sorted by height leave empty at this width
+	static double EstimateShelfWaste(std::vector<Vec2> sizes, double width);
 
-	void WriteAtlasImageData(ImageData& images, int width, int height);
-	bool PackAtlas(ImageData& images, Vec2 size);
-	bool PackAtlasShelf(ImageData& images, Vec2 size);
+	//copies the pixels of every image to where CreateLayout placed it
+	void WriteAtlasImageData(ImageData& images);
+	//allocates the pages CreateLayout sized, cleared to transparent
+	void CreateAtlasPages(ImageData& images);
+	//copies the pixels of one image to where CreateLayout placed it. images never overlap, so different images can be
+	//copied from different threads at once
+	static void CopyToAtlas(ImageData& images, int index, const unsigned char* image_pixels);
+	bool SplitPages(const ImageData& image_data, std::vector<std::vector<int>>& pages);
+	bool PackPages(ImageData& image_data, const std::vector<std::vector<int>>& pages, std::vector<Vec2>& page_sizes);
+	bool PackPage(const ImageData& image_data, Rect* rects);
+	//packs the page with the size solver, without trying a grid first
+	bool PackPageSearched(const ImageData& image_data, Rect* rects);
+	//finds the cell of a grid every image of the page fits in, if they are all the same size or nearly so. same_size
+	//is set if they are all exactly the size of the cell
+	bool GetGridCell(const ImageData& image_data, Vec2& cell, bool& same_size) const;
+	bool PackGrid(const ImageData& image_data, Rect* rects, Vec2 cell);
+	//whether an image this size counts as the same size as the cell in a grid
+	static bool InGridCell(Vec2 size, Vec2 cell);
+	//sorts the images of the page into buckets of sizes within the grid tolerance of each other. images of sizes with
+	//too few images for a block are loose
+	void GetGridBuckets(const ImageData& image_data, std::vector<GridBlock>& buckets, std::vector<int>& loose) const;
+	//lays out every bucket with enough images as a grid block and packs the blocks with the loose images, trying a few
+	//block widths. false if the page has no buckets or nothing packs
+	bool PackGridBlocks(const ImageData& image_data, Rect* rects);
+	//packs the page with its buckets laid out in blocks of about this width. leaves sorted_indices_ and the image area
+	//in the stats set to the blocks and loose images
+	bool PackGridBlocks(Rect* rects, const std::vector<GridBlock>& buckets, std::vector<int> loose, int width);
+	bool PackSmallestSize(const ImageData& image_data, Rect* rects);
+	bool PackPossibleSizes(Rect* rects, int num_rects);
+	bool PackSearchedSize(Rect* rects, int num_rects);
+	bool PackBestHeuristic(const ImageData& image_data, Rect* rects);
+	bool PackAllSortOrders(const ImageData& image_data, Rect* rects);
+	bool PackOptimized(const ImageData& image_data, Rect* rects);
+	bool PackExact(const ImageData& image_data, Rect* rects);
+	void SetupOptimizeRun(const ImageData& image_data, AtlasPacker& packer, int run) const;
+	//packs the page with the fast solver, or at the maximum size if no fast size fits, ignoring the deadline. the
+	//optimize and exact solvers keep this if nothing smaller is found in time
+	bool PackFloor(const ImageData& image_data, Rect* rects, Vec2& size);
+	bool PastDeadline() const;
+	bool NextPossibleSize();
+	bool PackPossibleSizesParallel(Rect* rects, int num_rects);
+	bool PackAtlas(Rect* rects, Vec2 size, Packers& packers, const std::atomic<bool>* cancelled = nullptr);
+	//packs with the same packers and rects as the last attempt. if that attempt failed and this size is as wide but
+	//taller, packers that give the same result either way carry on from the image that did not fit instead of starting over
+	bool ResumeAtlas(Rect* rects, Vec2 size, Packers& packers, const std::atomic<bool>* cancelled = nullptr);
 
-	void GetPossibleContainers(const ImageData& images, std::vector<Vec2>& possible_sizes);
+	bool GetPossibleContainers(const ImageData& images, std::vector<Vec2>& possible_sizes);
 	std::vector<int> GetSortedIndices(const ImageData& images);
+	//puts the images of this page in the current sort order
+	void SortPage(const ImageData& images);
 	
 	int max_width_ = MAX_DIMENSIONS;
 	int max_height_ = MAX_DIMENSIONS;
@@ -47,12 +187,45 @@ public:
 
 	int pixel_padding_ = 0;
 	bool pow_of_2_ = false;
+	//lets packers turn images 90 degrees when that fits better. a turned image only wins if it fits strictly better, so
+	//square images and ties are never turned
+	bool allow_rotation_ = false;
+	//images that do not fit in the maximum dimensions spill onto further atlas pages instead of failing
+	bool multi_page_ = false;
+	//number of candidate sizes packed at once. 1 packs one size at a time
+	int num_parallel_sizes_ = 1;
+	//after the best fit search, also tries every smaller size in case the images do not pack monotonically
+	bool verify_size_ = false;
+	//lays out images of the same or nearly the same size as grids instead of packing them one by one
+	bool use_grids_ = true;
+	//wall clock time the optimize solver spends looking for a smaller atlas
+	int time_budget_ms_ = 1000;
+	//if set, the exact solver keeps this width and looks for the shortest height instead of the smallest area
+	int exact_width_ = 0;
+	
+	//columns MaxRects splits every atlas into, 0 to choose them from the images. fixed while splitting pages, so whether
+	//some images fit does not depend on how many follow them
+	int max_rects_columns_ = 0;
 	
 	Algorithm algo_ = Algorithm::Shelf;
+	ShelfRule shelf_rule_ = ShelfRule::NextFit;
+	MaxRectsHeuristic heuristic_ = MaxRectsHeuristic::BestShortSideFit;
+	GuillotineSplit guillotine_split_ = GuillotineSplit::ShorterAxis;
+	bool guillotine_merge_ = true;
 	SizeSolver size_solver_ = SizeSolver::Fast;
+	SortOrder sort_order_ = SortOrder::Height;
 	std::vector<Vec2> possible_sizes_;
+	//candidate sizes at or above this area are skipped
+	int max_size_area_ = INT_MAX;
+	//area an earlier optimize run already packed in. sizes at least this large can not win, so searches stop there
+	int area_to_beat_ = INT_MAX;
+	//size searches give up once this passes. only set while optimizing or searching exactly
+	std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
 	Vec2 size_;
 	std::string metadata_;
 	Stats stats_;
 	std::vector<int> sorted_indices_;
+	SizeBounds bounds_;
+	Packers packers_;
+	std::deque<PackAttempt> attempts_;
 };
\ No newline at end of file
@@ -0,0 +1,132 @@
+#include "Bounds.h"
+
+#include <algorithm>
+#include <climits>
+#include <numeric>
+
+SizeBounds::SizeBounds(const ImageData& images, const std::vector<int>& indices, int padding, bool allow_rotation)
+	: padding_(padding), allow_rotation_(allow_rotation)
+{
+	std::vector<Vec2> sizes;
+	std::vector<long long> areas;
+	for (int i : indices) {
+		Vec2 size = { images.rects_[i].w + padding, images.rects_[i].h + padding };
+		if (allow_rotation) {
+			max_long_side_ = std::max(max_long_side_, std::max(size.x, size.y));
+			size.x = size.y = std::min(size.x, size.y);
+		}
+
+		sizes.push_back(size);
+		areas.push_back((long long)(images.rects_[i].w + padding) * (images.rects_[i].h + padding));
+		total_area_ += areas.back();
+	}
+
+	BuildAxis(columns_, sizes, areas);
+	for (Vec2& size : sizes) {
+		std::swap(size.x, size.y);
+	}
+	BuildAxis(rows_, sizes, areas);
+}
+
+void SizeBounds::BuildAxis(Axis& axis, const std::vector<Vec2>& sizes, const std::vector<long long>& areas) const
+{
+	std::vector<int> order(sizes.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&sizes](int i, int j) { return sizes[i].y > sizes[j].y; });
+
+	axis.breadths.push_back(0);
+	axis.areas.push_back(0);
+	for (int i : order) {
+		axis.breadths.push_back(axis.breadths.back() + sizes[i].x);
+		axis.areas.push_back(axis.areas.back() + areas[i]);
+		axis.max_breadth = std::max(axis.max_breadth, sizes[i].x);
+
+		if (axis.steps.empty() || axis.steps.back() != sizes[i].y) {
+			axis.steps.push_back(sizes[i].y);
+		}
+	}
+
+	//counts are looked up for every step of every candidate size, so a table beats searching the sorted lengths
+	int longest = axis.steps.empty() ? 0 : axis.steps[0];
+	axis.counts.assign(longest + 2, 0);
+	for (Vec2 size : sizes) {
+		++axis.counts[size.y];
+	}
+	for (int length = longest; length >= 0; --length) {
+		axis.counts[length] += axis.counts[length + 1];
+	}
+}
+
+int SizeBounds::CountAtLeast(const Axis& axis, int length)
+{
+	return axis.counts[std::clamp(length, 0, (int)axis.counts.size() - 1)];
+}
+
+int SizeBounds::MinWidth(int height) const
+{
+	return CachedMinBreadth(columns_, min_widths_, height);
+}
+
+int SizeBounds::MinHeight(int width) const
+{
+	return CachedMinBreadth(rows_, min_heights_, width);
+}
+
+int SizeBounds::CachedMinBreadth(const Axis& axis, std::vector<int>& cache, int length) const
+{
+	if (length < 0) {
+		return INT_MAX;
+	}
+
+	if (length >= cache.size()) {
+		cache.resize(length + 1, -1);
+	}
+	if (cache[length] == -1) {
+		cache[length] = MinBreadth(axis, length);
+	}
+	return cache[length];
+}
+
+bool SizeBounds::Fits(Vec2 size) const
+{
+	return size.x >= MinWidth(size.y) && size.y >= MinHeight(size.x);
+}
+
+int SizeBounds::MinBreadth(const Axis& axis, int length) const
+{
+	if (axis.steps.empty()) {
+		return 0;
+	}
+
+	length += padding_;
+	if (length <= 0 || axis.steps[0] > length) {
+		return INT_MAX;
+	}
+
+	long long breadth = (total_area_ + length - 1) / length;
+
+	//a turned image still has to lie flat if its long side does not fit along the known side
+	breadth = std::max<long long>(breadth, allow_rotation_ && max_long_side_ > length ? max_long_side_ : axis.max_breadth);
+
+	//images longer than half the length can not share any line across the breadth, so they all sit side by side
+	int num_long = CountAtLeast(axis, length / 2 + 1);
+	breadth = std::max(breadth, axis.breadths[num_long]);
+
+	//for every step at most half the length, images at least step long can not share a line with those longer than
+	//length - step. the longest of those take up their breadth alone, and the rest of the images at least step long
+	//have to fit in the area beside them, including whatever the other long images leave free
+	for (int step : axis.steps) {
+		if (step > length / 2) {
+			continue;
+		}
+
+		int num_alone = CountAtLeast(axis, length - step + 1);
+		int num_at_least_step = CountAtLeast(axis, step);
+		long long alone = axis.breadths[num_alone];
+		long long long_rest = axis.breadths[num_long] - alone;
+		long long area = axis.areas[num_at_least_step] - axis.areas[num_alone];
+		breadth = std::max(breadth, alone + std::max(long_rest, (area + length - 1) / length));
+	}
+
+	return (int)std::min<long long>(breadth - padding_, INT_MAX);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "ImageData.h"
+
+#include <vector>
+
+//lower bounds on the atlas size a set of images needs, whichever packer is used. besides the total area, images longer
+//than half the atlas height can never be stacked on top of each other, and images that can not share a column with
+//them have to fit in the space left beside them. a size that fails a bound can not be packed, so it can be skipped
+//without running the packer. padding is added to every image and to the atlas, the same way the packers place them
+class SizeBounds
+{
+public:
+	SizeBounds() = default;
+	SizeBounds(const ImageData& images, const std::vector<int>& indices, int padding, bool allow_rotation);
+
+	//narrowest width the images could fit in at this height, INT_MAX if no width can hold them
+	int MinWidth(int height) const;
+	//shortest height the images could fit in at this width, INT_MAX if no height can hold them
+	int MinHeight(int width) const;
+	bool Fits(Vec2 size) const;
+private:
+	//images seen along one side of the atlas. length is how far an image reaches along the known side, breadth how far
+	//along the side being bounded. with rotation both are the short side, the least an image takes up either way
+	struct Axis
+	{
+		//prefix sums of breadth and area over images sorted by descending length
+		std::vector<long long> breadths;
+		std::vector<long long> areas;
+		//number of images at least as long as the index, up to the longest image plus one
+		std::vector<int> counts;
+		//distinct lengths, descending
+		std::vector<int> steps;
+		int max_breadth = 0;
+	};
+
+	void BuildAxis(Axis& axis, const std::vector<Vec2>& sizes, const std::vector<long long>& areas) const;
+	int MinBreadth(const Axis& axis, int length) const;
+	int CachedMinBreadth(const Axis& axis, std::vector<int>& cache, int length) const;
+	static int CountAtLeast(const Axis& axis, int length);
+
+	//length along the height is the image height, so images stack in columns
+	Axis columns_;
+	Axis rows_;
+	//candidate sizes share heights and widths, so each bound is only worked out the first time its length is needed,
+	//-1 until then. filled in by const calls, so a SizeBounds can not be shared between threads
+	mutable std::vector<int> min_widths_;
+	mutable std::vector<int> min_heights_;
+	long long total_area_ = 0;
+	int max_long_side_ = 0;
+	int padding_ = 0;
+	bool allow_rotation_ = false;
+};
\ No newline at end of file
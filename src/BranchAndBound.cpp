@@ -0,0 +1,202 @@
+#include "BranchAndBound.h"
+
+#include <algorithm>
+
+//the clock is only read every so many nodes, reading it costs about as much as a node
+constexpr int DEADLINE_CHECK_INTERVAL = 1024;
+//failed states kept to skip. past this many, new ones are searched again instead of kept
+constexpr size_t MAX_FAILED_STATES = 1 << 20;
+
+bool BranchAndBound::PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, std::chrono::steady_clock::time_point deadline)
+{
+	size_ = { size.x + padding, size.y + padding };
+	allow_rotation_ = allow_rotation;
+	deadline_ = deadline;
+	num_nodes_ = 0;
+	timed_out_ = false;
+	image_sizes_.clear();
+	placements_.clear();
+
+	area_left_ = 0;
+	for (int i : sorted_indices) {
+		Vec2 image = { rects[i].w + padding, rects[i].h + padding };
+		//turned images are the same size either way round
+		if (allow_rotation && image.x < image.y) {
+			std::swap(image.x, image.y);
+		}
+		area_left_ += (long long)image.x * image.y;
+
+		auto image_size = std::find_if(image_sizes_.begin(), image_sizes_.end(), [image](const ImageSize& other) { return other.size.x == image.x && other.size.y == image.y; });
+		if (image_size == image_sizes_.end()) {
+			image_sizes_.push_back({ image, {} });
+			image_size = image_sizes_.end() - 1;
+		}
+		image_size->indices.push_back(i);
+	}
+
+	num_left_ = sorted_indices.size();
+	if (size.x <= 0 || size.y <= 0 || area_left_ > (long long)size_.x * size_.y) {
+		return false;
+	}
+
+	failed_states_.clear();
+	if (!Search({})) {
+		return false;
+	}
+
+	for (const Placement& placement : placements_) {
+		Rect& rect = rects[placement.index];
+		rect.x = placement.x;
+		rect.y = placement.y;
+		rect.rotated = placement.w != rect.w + padding;
+	}
+	return true;
+}
+
+bool BranchAndBound::TimedOut() const
+{
+	return timed_out_;
+}
+
+bool BranchAndBound::Search(const std::vector<Vec2>& steps)
+{
+	if (num_left_ == 0) {
+		return true;
+	}
+
+	if (++num_nodes_ % DEADLINE_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline_) {
+		timed_out_ = true;
+	}
+	if (timed_out_) {
+		return false;
+	}
+
+	if (CoveredArea(steps) + DeadArea(steps) + area_left_ > (long long)size_.x * size_.y) {
+		return false;
+	}
+
+	//the same images can be placed in many orders to end up with the same staircase, and what still fits only depends
+	//on the staircase and which images are left
+	std::string state;
+	for (const ImageSize& image_size : image_sizes_) {
+		state.append((const char*)&image_size.num_placed, sizeof(int));
+	}
+	state.append((const char*)steps.data(), steps.size() * sizeof(Vec2));
+	if (failed_states_.count(state) > 0) {
+		return false;
+	}
+
+	//inner corners, from below the first step at the left edge to right of the last step at the top edge
+	std::vector<Vec2> corners;
+	for (int i = 0; i <= steps.size(); ++i) {
+		corners.push_back({ i > 0 ? steps[i - 1].x : 0, i < steps.size() ? steps[i].y : 0 });
+	}
+
+	std::vector<Vec2> next;
+	for (Vec2 corner : corners) {
+		for (ImageSize& image_size : image_sizes_) {
+			if (image_size.num_placed == image_size.indices.size()) {
+				continue;
+			}
+
+			int num_turns = allow_rotation_ && image_size.size.x != image_size.size.y ? 2 : 1;
+			for (int turn = 0; turn < num_turns; ++turn) {
+				Vec2 image = turn == 0 ? image_size.size : Vec2{ image_size.size.y, image_size.size.x };
+				Vec2 step = { corner.x + image.x, corner.y + image.y };
+				if (step.x > size_.x || step.y > size_.y) {
+					continue;
+				}
+
+				next = steps;
+				AddStep(next, step);
+				long long image_area = (long long)image.x * image.y;
+
+				placements_.push_back({ image_size.indices[image_size.num_placed], corner.x, corner.y, image.x });
+				++image_size.num_placed;
+				--num_left_;
+				area_left_ -= image_area;
+
+				if (Search(next)) {
+					return true;
+				}
+
+				placements_.pop_back();
+				--image_size.num_placed;
+				++num_left_;
+				area_left_ += image_area;
+				if (timed_out_) {
+					return false;
+				}
+			}
+		}
+	}
+
+	//only reached once every branch was searched without running out of time, so the state is known to fail
+	if (failed_states_.size() < MAX_FAILED_STATES) {
+		failed_states_.insert(std::move(state));
+	}
+	return false;
+}
+
+long long BranchAndBound::CoveredArea(const std::vector<Vec2>& steps)
+{
+	//everything under the staircase that no image covers can never be used
+	long long area = 0;
+	for (int i = 0; i < steps.size(); ++i) {
+		area += (long long)(steps[i].x - (i > 0 ? steps[i - 1].x : 0)) * steps[i].y;
+	}
+	return area;
+}
+
+long long BranchAndBound::DeadArea(const std::vector<Vec2>& steps) const
+{
+	//the space right of the staircase splits into columns, one beside each corner. images reaching into a column start
+	//no higher than its corner, so a line down the column only crosses images still left, each at most once. the
+	//column loses whatever part of its height no sum of those heights reaches. the same goes for rows below each
+	//corner and the widths left, and the larger of the two is dead
+	std::bitset<MAX_SUM_LENGTH> heights, widths;
+	heights[0] = widths[0] = true;
+	for (const ImageSize& image_size : image_sizes_) {
+		for (int i = image_size.num_placed; i < image_size.indices.size(); ++i) {
+			if (allow_rotation_) {
+				heights |= (heights << image_size.size.x) | (heights << image_size.size.y);
+			}
+			else {
+				heights |= heights << image_size.size.y;
+				widths |= widths << image_size.size.x;
+			}
+		}
+	}
+	if (allow_rotation_) {
+		widths = heights;
+	}
+
+	long long dead_columns = 0, dead_rows = 0;
+	for (int corner = 0; corner <= steps.size(); ++corner) {
+		int left = corner > 0 ? steps[corner - 1].x : 0;
+		int right = corner < steps.size() ? steps[corner].x : size_.x;
+		int top = corner < steps.size() ? steps[corner].y : 0;
+		int bottom = corner > 0 ? steps[corner - 1].y : size_.y;
+
+		dead_columns += (long long)(right - left) * (size_.y - top - LongestSum(heights, size_.y - top));
+		dead_rows += (long long)(bottom - top) * (size_.x - left - LongestSum(widths, size_.x - left));
+	}
+	return std::max(dead_columns, dead_rows);
+}
+
+int BranchAndBound::LongestSum(const std::bitset<MAX_SUM_LENGTH>& sums, int length)
+{
+	for (int sum = std::min(length, MAX_SUM_LENGTH - 1); sum > 0; --sum) {
+		if (sums[sum]) {
+			return sum;
+		}
+	}
+	return 0;
+}
+
+void BranchAndBound::AddStep(std::vector<Vec2>& steps, Vec2 step)
+{
+	//steps the new one reaches past on both axes are no longer corners of the staircase
+	steps.erase(std::remove_if(steps.begin(), steps.end(), [step](Vec2 other) { return other.x <= step.x && other.y <= step.y; }), steps.end());
+	steps.insert(std::find_if(steps.begin(), steps.end(), [step](Vec2 other) { return other.x > step.x; }), step);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ImageData.h"
+
+#include <bitset>
+#include <chrono>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+//atlas sides with padding can not be longer than this
+constexpr int MAX_SUM_LENGTH = 4096 + 64;
+
+//exact packer for a handful of images. the images placed so far cover a staircase from the top left of the atlas, and
+//any packing can be rebuilt by placing its images one at a time in the inner corners of that staircase. trying every
+//size of image in every corner visits every packing, so if none fits the atlas can not be packed at all. space under
+//the staircase that no image covers stays empty, and once that is more than the atlas has to spare the branch is cut.
+//runs in exponential time, so it gives up once the deadline passes
+class BranchAndBound
+{
+public:
+	//places rects in some order so they fit, turning them if allow_rotation is set. returns false if they do not fit,
+	//or if the deadline passed first, which TimedOut tells apart
+	bool PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, std::chrono::steady_clock::time_point deadline);
+	bool TimedOut() const;
+private:
+	//images of the same size can be swapped for each other, so each size is only tried once at every step
+	struct ImageSize
+	{
+		Vec2 size;
+		std::vector<int> indices;
+		int num_placed = 0;
+	};
+
+	struct Placement
+	{
+		int index = 0;
+		int x = 0;
+		int y = 0;
+		int w = 0;
+	};
+
+	//steps are the bottom right corners of the staircase, by ascending x and descending y
+	bool Search(const std::vector<Vec2>& steps);
+	static long long CoveredArea(const std::vector<Vec2>& steps);
+	long long DeadArea(const std::vector<Vec2>& steps) const;
+	//longest sum of image sides up to length, from the set of all sums
+	static int LongestSum(const std::bitset<MAX_SUM_LENGTH>& sums, int length);
+	static void AddStep(std::vector<Vec2>& steps, Vec2 step);
+
+	Vec2 size_;
+	bool allow_rotation_ = false;
+	std::vector<ImageSize> image_sizes_;
+	std::vector<Placement> placements_;
+	int num_left_ = 0;
+	//area of the images not placed yet
+	long long area_left_ = 0;
+	//staircases and placed images that could not be finished
+	std::unordered_set<std::string> failed_states_;
+	std::chrono::steady_clock::time_point deadline_;
+	long long num_nodes_ = 0;
+	bool timed_out_ = false;
+};
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include "FitKernel.h"
+
+#include <climits>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FIT_KERNEL_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+//gcc and clang only emit simd instructions in functions marked for them. msvc allows them anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+using FitKernel = int (*)(const int*, const int*, const int*, int, int, int);
+
+//picks the better of two candidates the same way in every kernel so they all return the same index
+static inline void ReduceBestFit(int score, int order, int index, int& best_score, int& best_order, int& best_index)
+{
+	if (score >= 0 && (score < best_score || (score == best_score && order < best_order))) {
+		best_score = score;
+		best_order = order;
+		best_index = index;
+	}
+}
+
+static int FindBestShortSideFitScalar(const int* free_widths, const int* free_heights, const int* orders, int count, int width, int height)
+{
+	int best_score = INT_MAX, best_order = INT_MAX, best_index = -1;
+	for (int i = 0; i < count; ++i) {
+		int leftover_width = free_widths[i] - width;
+		int leftover_height = free_heights[i] - height;
+		int score = leftover_width < leftover_height ? leftover_width : leftover_height;
+		ReduceBestFit(score, orders[i], i, best_score, best_order, best_index);
+	}
+
+	return best_index;
+}
+
+#ifdef FIT_KERNEL_X86
+
+TARGET_SSE2 static int FindBestShortSideFitSse2(const int* free_widths, const int* free_heights, const int* orders, int count, int width, int height)
+{
+	//each lane keeps its own best candidate, then the lanes are reduced at the end. sse2 has no 32 bit min or blend,
+	//so both are built from compares and masks
+	const __m128i image_width = _mm_set1_epi32(width);
+	const __m128i image_height = _mm_set1_epi32(height);
+	const __m128i no_fit = _mm_set1_epi32(-1);
+	const __m128i step = _mm_set1_epi32(4);
+	__m128i index = _mm_setr_epi32(0, 1, 2, 3);
+	__m128i best_score = _mm_set1_epi32(INT_MAX);
+	__m128i best_order = _mm_set1_epi32(INT_MAX);
+	__m128i best_index = _mm_set1_epi32(-1);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i leftover_width = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(free_widths + i)), image_width);
+		__m128i leftover_height = _mm_sub_epi32(_mm_loadu_si128((const __m128i*)(free_heights + i)), image_height);
+		__m128i order = _mm_loadu_si128((const __m128i*)(orders + i));
+
+		__m128i width_larger = _mm_cmpgt_epi32(leftover_width, leftover_height);
+		__m128i score = _mm_or_si128(_mm_and_si128(width_larger, leftover_height), _mm_andnot_si128(width_larger, leftover_width));
+
+		__m128i fits = _mm_cmpgt_epi32(score, no_fit);
+		__m128i lower = _mm_cmpgt_epi32(best_score, score);
+		__m128i tied = _mm_and_si128(_mm_cmpeq_epi32(score, best_score), _mm_cmpgt_epi32(best_order, order));
+		__m128i better = _mm_and_si128(fits, _mm_or_si128(lower, tied));
+
+		best_score = _mm_or_si128(_mm_and_si128(better, score), _mm_andnot_si128(better, best_score));
+		best_order = _mm_or_si128(_mm_and_si128(better, order), _mm_andnot_si128(better, best_order));
+		best_index = _mm_or_si128(_mm_and_si128(better, index), _mm_andnot_si128(better, best_index));
+		index = _mm_add_epi32(index, step);
+	}
+
+	alignas(16) int lane_scores[4], lane_orders[4], lane_indices[4];
+	_mm_store_si128((__m128i*)lane_scores, best_score);
+	_mm_store_si128((__m128i*)lane_orders, best_order);
+	_mm_store_si128((__m128i*)lane_indices, best_index);
+
+	int result_score = INT_MAX, result_order = INT_MAX, result_index = -1;
+	for (int lane = 0; lane < 4; ++lane) {
+		if (lane_indices[lane] != -1) {
+			ReduceBestFit(lane_scores[lane], lane_orders[lane], lane_indices[lane], result_score, result_order, result_index);
+		}
+	}
+
+	for (; i < count; ++i) {
+		int leftover_width = free_widths[i] - width;
+		int leftover_height = free_heights[i] - height;
+		ReduceBestFit(leftover_width < leftover_height ? leftover_width : leftover_height, orders[i], i, result_score, result_order, result_index);
+	}
+
+	return result_index;
+}
+
+TARGET_AVX2 static int FindBestShortSideFitAvx2(const int* free_widths, const int* free_heights, const int* orders, int count, int width, int height)
+{
+	//same as the sse2 kernel with 8 lanes and native min and blend
+	const __m256i image_width = _mm256_set1_epi32(width);
+	const __m256i image_height = _mm256_set1_epi32(height);
+	const __m256i no_fit = _mm256_set1_epi32(-1);
+	const __m256i step = _mm256_set1_epi32(8);
+	__m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i best_score = _mm256_set1_epi32(INT_MAX);
+	__m256i best_order = _mm256_set1_epi32(INT_MAX);
+	__m256i best_index = _mm256_set1_epi32(-1);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i leftover_width = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(free_widths + i)), image_width);
+		__m256i leftover_height = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i*)(free_heights + i)), image_height);
+		__m256i order = _mm256_loadu_si256((const __m256i*)(orders + i));
+		__m256i score = _mm256_min_epi32(leftover_width, leftover_height);
+
+		__m256i fits = _mm256_cmpgt_epi32(score, no_fit);
+		__m256i lower = _mm256_cmpgt_epi32(best_score, score);
+		__m256i tied = _mm256_and_si256(_mm256_cmpeq_epi32(score, best_score), _mm256_cmpgt_epi32(best_order, order));
+		__m256i better = _mm256_and_si256(fits, _mm256_or_si256(lower, tied));
+
+		best_score = _mm256_blendv_epi8(best_score, score, better);
+		best_order = _mm256_blendv_epi8(best_order, order, better);
+		best_index = _mm256_blendv_epi8(best_index, index, better);
+		index = _mm256_add_epi32(index, step);
+	}
+
+	alignas(32) int lane_scores[8], lane_orders[8], lane_indices[8];
+	_mm256_store_si256((__m256i*)lane_scores, best_score);
+	_mm256_store_si256((__m256i*)lane_orders, best_order);
+	_mm256_store_si256((__m256i*)lane_indices, best_index);
+
+	int result_score = INT_MAX, result_order = INT_MAX, result_index = -1;
+	for (int lane = 0; lane < 8; ++lane) {
+		if (lane_indices[lane] != -1) {
+			ReduceBestFit(lane_scores[lane], lane_orders[lane], lane_indices[lane], result_score, result_order, result_index);
+		}
+	}
+
+	for (; i < count; ++i) {
+		int leftover_width = free_widths[i] - width;
+		int leftover_height = free_heights[i] - height;
+		ReduceBestFit(leftover_width < leftover_height ? leftover_width : leftover_height, orders[i], i, result_score, result_order, result_index);
+	}
+
+	return result_index;
+}
+
+static bool CpuSupportsAvx2()
+{
+#ifdef _MSC_VER
+	//avx2 also needs the os to save the upper halves of the registers
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7) {
+		return false;
+	}
+	__cpuid(info, 1);
+	bool os_saves_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 0x6) == 0x6;
+	__cpuidex(info, 7, 0);
+	return os_saves_avx && (info[1] & (1 << 5));
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static bool CpuSupportsSse2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	return true;
+#elif defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return info[3] & (1 << 26);
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+#endif
+}
+
+#endif
+
+struct FitKernelChoice
+{
+	FitKernel kernel;
+	const char* name;
+};
+
+static FitKernelChoice ChooseFitKernel()
+{
+#ifdef FIT_KERNEL_X86
+	if (CpuSupportsAvx2()) {
+		return { FindBestShortSideFitAvx2, "avx2" };
+	}
+	if (CpuSupportsSse2()) {
+		return { FindBestShortSideFitSse2, "sse2" };
+	}
+#endif
+	return { FindBestShortSideFitScalar, "scalar" };
+}
+
+static const FitKernelChoice& GetFitKernel()
+{
+	static const FitKernelChoice choice = ChooseFitKernel();
+	return choice;
+}
+
+int FindBestShortSideFit(const int* free_widths, const int* free_heights, const int* orders, int count, int width, int height)
+{
+	return GetFitKernel().kernel(free_widths, free_heights, orders, count, width, height);
+}
+
+const char* GetFitKernelName()
+{
+	return GetFitKernel().name;
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+//finds the free rect with the best short side fit for a width x height image. free rects are passed as separate arrays
+//so they can be scored several at a time. empty slots must have a negative width so they never fit, and ties go to the
+//lowest order. returns the index of the best free rect, or -1 if the image fits nowhere
+int FindBestShortSideFit(const int* free_widths, const int* free_heights, const int* orders, int count, int width, int height);
+
+//name of the kernel picked for this cpu: "avx2", "sse2" or "scalar"
+const char* GetFitKernelName();
\ No newline at end of file
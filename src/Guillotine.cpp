@@ -0,0 +1,133 @@
+#include "Guillotine.h"
+
+#include <algorithm>
+
+bool Guillotine::PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, GuillotineSplit split, bool merge, bool allow_rotation, const std::atomic<bool>* cancelled)
+{
+	free_rects_.clear();
+	if (size.x > 0 && size.y > 0) {
+		free_rects_.push_back({ 0, 0, size.x + padding, size.y + padding });
+	}
+
+	for (int image = 0; image < sorted_indices.size(); ++image) {
+
+		if (free_rects_.empty() || (cancelled != nullptr && *cancelled)) {
+			return false;
+		}
+
+		int curr_idx = sorted_indices[image];
+		Rect padded = { 0, 0, rects[curr_idx].w + padding, rects[curr_idx].h + padding };
+
+		int best_fit_index = FindBestFit(padded.w, padded.h);
+		rects[curr_idx].rotated = false;
+
+		if (allow_rotation && padded.w != padded.h) {
+			Rect turned = { 0, 0, padded.h, padded.w };
+			int turned_index = FindBestFit(turned.w, turned.h);
+			if (turned_index != -1 && (best_fit_index == -1 || IsBetterFit(turned_index, turned.w, turned.h, best_fit_index, padded.w, padded.h))) {
+				best_fit_index = turned_index;
+				padded = turned;
+				rects[curr_idx].rotated = true;
+			}
+		}
+
+		//didnt find any fits
+		if (best_fit_index == -1) {
+			return false;
+		}
+
+		Rect free_rect = free_rects_[best_fit_index];
+		free_rects_.erase(free_rects_.begin() + best_fit_index);
+
+		padded.x = rects[curr_idx].x = free_rect.x;
+		padded.y = rects[curr_idx].y = free_rect.y;
+		SplitFreeRect(free_rect, padded, split, merge);
+	}
+
+	return true;
+}
+
+int Guillotine::FindBestFit(int width, int height) const
+{
+	int best_fit_index = -1;
+
+	for (int i = 0; i < free_rects_.size(); ++i) {
+		if (free_rects_[i].w < width || free_rects_[i].h < height) {
+			continue;
+		}
+
+		if (best_fit_index == -1 || IsBetterFit(i, width, height, best_fit_index, width, height)) {
+			best_fit_index = i;
+		}
+	}
+
+	return best_fit_index;
+}
+
+bool Guillotine::IsBetterFit(int index, int width, int height, int other_index, int other_width, int other_height) const
+{
+	//smallest free rect wins, then the shorter leftover side. equal fits keep the other, which is the older free rect
+	long long area = (long long)free_rects_[index].w * free_rects_[index].h;
+	long long other_area = (long long)free_rects_[other_index].w * free_rects_[other_index].h;
+	if (area != other_area) {
+		return area < other_area;
+	}
+
+	int short_side = std::min(free_rects_[index].w - width, free_rects_[index].h - height);
+	int other_short_side = std::min(free_rects_[other_index].w - other_width, free_rects_[other_index].h - other_height);
+	return short_side < other_short_side;
+}
+
+void Guillotine::SplitFreeRect(const Rect& free_rect, const Rect& image, GuillotineSplit split, bool merge)
+{
+	int leftover_width = free_rect.w - image.w;
+	int leftover_height = free_rect.h - image.h;
+
+	//a horizontal cut gives the bottom rect the full width of the free rect, a vertical cut gives the right rect the full height
+	bool horizontal_cut = false;
+	switch (split) {
+		case GuillotineSplit::ShorterAxis: { horizontal_cut = leftover_width <= leftover_height; break; }
+		case GuillotineSplit::LongerAxis: { horizontal_cut = leftover_width > leftover_height; break; }
+		case GuillotineSplit::MinArea: { horizontal_cut = (long long)image.w * leftover_height > (long long)leftover_width * image.h; break; }
+		case GuillotineSplit::MaxArea: { horizontal_cut = (long long)image.w * leftover_height <= (long long)leftover_width * image.h; break; }
+	}
+
+	Rect bottom = { free_rect.x, free_rect.y + image.h, horizontal_cut ? free_rect.w : image.w, leftover_height };
+	Rect right = { free_rect.x + image.w, free_rect.y, leftover_width, horizontal_cut ? image.h : free_rect.h };
+
+	if (bottom.w > 0 && bottom.h > 0) {
+		AddFreeRect(bottom, merge);
+	}
+	if (right.w > 0 && right.h > 0) {
+		AddFreeRect(right, merge);
+	}
+}
+
+void Guillotine::AddFreeRect(Rect rect, bool merge)
+{
+	//only the new rect can have become mergeable, so join it with any free rect sharing a whole edge until none is left.
+	//joining two rects that share a whole edge keeps the free list guillotine cuttable
+	for (bool merged = merge; merged;) {
+		merged = false;
+		for (int i = 0; i < free_rects_.size(); ++i) {
+			const Rect& other = free_rects_[i];
+			if (other.x == rect.x && other.w == rect.w && (other.y + other.h == rect.y || rect.y + rect.h == other.y)) {
+				rect.y = std::min(rect.y, other.y);
+				rect.h += other.h;
+				merged = true;
+			}
+			else if (other.y == rect.y && other.h == rect.h && (other.x + other.w == rect.x || rect.x + rect.w == other.x)) {
+				rect.x = std::min(rect.x, other.x);
+				rect.w += other.w;
+				merged = true;
+			}
+
+			if (merged) {
+				free_rects_.erase(free_rects_.begin() + i);
+				break;
+			}
+		}
+	}
+
+	free_rects_.push_back(rect);
+}
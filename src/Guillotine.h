@@ -0,0 +1,36 @@
+#pragma once
+
+#include "ImageData.h"
+
+#include <atomic>
+#include <vector>
+
+//rule used to cut the free rect an image was placed in into two. the cut runs the whole length of the rect on one
+//axis, so every free rect and the atlas itself can always be split with straight cuts
+enum class GuillotineSplit
+{
+	//cut along the shorter leftover side, keeping the larger leftover rect as big as possible
+	ShorterAxis,
+	LongerAxis,
+	//cut so the smaller of the two leftover rects has the least or most area
+	MinArea,
+	MaxArea
+};
+
+//guillotine packer. each image goes into the free rect with the best area fit and the rest of that rect is cut into
+//two. each instance owns its own free list so separate instances can pack concurrently
+class Guillotine
+{
+public:
+	//places rects in sorted_indices order, turning them when that fits better if allow_rotation is set. stops early and
+	//returns false if cancelled is set while packing. merging joins free rects that share a whole edge, which leaves
+	//room for larger images at the cost of some speed
+	bool PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, GuillotineSplit split, bool merge, bool allow_rotation, const std::atomic<bool>* cancelled = nullptr);
+private:
+	int FindBestFit(int width, int height) const;
+	bool IsBetterFit(int index, int width, int height, int other_index, int other_width, int other_height) const;
+	void SplitFreeRect(const Rect& free_rect, const Rect& image, GuillotineSplit split, bool merge);
+	void AddFreeRect(Rect rect, bool merge);
+
+	std::vector<Rect> free_rects_;
+};
\ No newline at end of file
@@ -1,34 +1,167 @@
 #include "ImageData.h"
 
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#include <climits>
 #include <filesystem>
+#include <functional>
 #include <iostream>
 
-void GetImageData(const std::vector<std::string>& paths, ImageData& image_data)
+int ImageData::AddImage(const std::string& path, int w, int h)
 {
+	rects_.push_back({ 0, 0, w, h });
+	data_.push_back(nullptr);
+	paths_.push_back(path);
+	pages_.push_back(0);
+	return num_images_++;
+}
 
-	//clear previous image data
-	for (int i = 0; i < image_data.num_images_; ++i) {
-		if (image_data.data_[i] != nullptr) {
-			stbi_image_free(image_data.data_[i]);
+void ImageData::Clear()
+{
+	for (unsigned char* data : data_) {
+		if (data != nullptr) {
+			stbi_image_free(data);
 		}
 	}
+	for (unsigned char* page : atlas_data_) {
+		delete[] page;
+	}
 
-	image_data.num_images_ = 0;
+	rects_.clear();
+	data_.clear();
+	paths_.clear();
+	pages_.clear();
+	num_images_ = 0;
+	atlas_rects_.clear();
+	atlas_data_.clear();
+}
 
-	for (int i = 0; i < paths.size(); ++i) {
+static void ReportErrors(const std::vector<std::string>& paths, const std::vector<std::string>& errors)
+{
+	for (int i = 0; i < errors.size(); ++i) {
+		if (!errors[i].empty()) {
+			std::cout << "Unable to load " << paths[i] << " (" << errors[i] << ").\n";
+		}
+	}
+}
 
-		image_data.data_[i] = stbi_load(paths[i].c_str(), &image_data.rects_[i].w, &image_data.rects_[i].h, nullptr, 4);
+//stb_image reads from memory with an int length
+static bool CanRead(const MappedFile& file, std::string& error)
+{
+	if (file.Data() == nullptr) {
+		error = "can't open, or empty";
+		return false;
+	}
+	if (file.Size() > INT_MAX) {
+		error = "file too large";
+		return false;
+	}
+	return true;
+}
 
-		if (image_data.data_[i] == nullptr) {
-			std::cout << "Unable to load " << paths[i] << ".\n";
+//starts reading in every file that will be decoded before any of them are, so decoding the first files overlaps with
+//reading the rest instead of each thread waiting on its own file
+static void ReadAhead(const std::vector<std::string>& paths, const ImageData& image_data)
+{
+	ThreadPool::Shared().ParallelFor(image_data.num_images_, [&](int i) {
+		if (image_data.rects_[i].w > 0) {
+			MappedFile::WillNeed(paths[i]);
 		}
+	});
+}
+
+//decodes an image probed by GetImageSizes. returns nullptr with the reason in error if it fails
+static unsigned char* DecodeImage(const std::string& path, const Rect& rect, std::string& error)
+{
+	MappedFile file(path);
+	if (!CanRead(file, error)) {
+		return nullptr;
+	}
+
+	int w = 0, h = 0;
+	unsigned char* pixels = stbi_load_from_memory(file.Data(), (int)file.Size(), &w, &h, nullptr, 4);
+	if (pixels == nullptr) {
+		const char* reason = stbi_failure_reason();
+		error = reason != nullptr ? reason : "unknown error";
+		return nullptr;
+	}
 
-		image_data.paths_[i] = std::filesystem::path(paths[i]).generic_u8string();;
+	//the file changed since it was probed, so the pixels would not fit where the image was packed
+	if (w != rect.w || h != rect.h) {
+		stbi_image_free(pixels);
+		error = "size changed while loading";
+		return nullptr;
+	}
+	return pixels;
+}
+
+void GetImageSizes(const std::vector<std::string>& paths, ImageData& image_data)
+{
+	image_data.Clear();
+
+	//every image is probed into its own slot on whichever thread picks it up, and added afterwards in path order so
+	//indices do not depend on the threads. stb_image keeps its failure reason per thread, so it is read on the thread
+	//that failed
+	std::vector<Vec2> sizes(paths.size());
+	std::vector<std::string> errors(paths.size());
+	ThreadPool::Shared().ParallelFor(paths.size(), [&](int i) {
+		//read through stdio rather than mapped, since a fault on a mapping reads in far more than the few bytes of header
+		if (!stbi_info(paths[i].c_str(), &sizes[i].x, &sizes[i].y, nullptr)) {
+			const char* reason = stbi_failure_reason();
+			errors[i] = reason != nullptr ? reason : "unknown error";
+			sizes[i] = { 0, 0 };
+		}
+	});
+	ReportErrors(paths, errors);
 
-		++image_data.num_images_;
+	image_data.rects_.reserve(paths.size());
+	image_data.data_.reserve(paths.size());
+	image_data.paths_.reserve(paths.size());
+	image_data.pages_.reserve(paths.size());
+	for (int i = 0; i < paths.size(); ++i) {
+		image_data.AddImage(std::filesystem::path(paths[i]).generic_u8string(), sizes[i].x, sizes[i].y);
 	}
+}
+
+void LoadImagePixels(const std::vector<std::string>& paths, ImageData& image_data)
+{
+	ReadAhead(paths, image_data);
+
+	std::vector<std::string> errors(image_data.num_images_);
+	ThreadPool::Shared().ParallelFor(image_data.num_images_, [&](int i) {
+		//images that failed to probe were already reported
+		if (image_data.rects_[i].w > 0) {
+			image_data.data_[i] = DecodeImage(paths[i], image_data.rects_[i], errors[i]);
+		}
+	});
+	ReportErrors(paths, errors);
+}
+
+void LoadImagePixels(const std::vector<std::string>& paths, const ImageData& image_data, const std::function<void(int, const unsigned char*)>& use_pixels)
+{
+	ReadAhead(paths, image_data);
+
+	std::vector<std::string> errors(image_data.num_images_);
+	ThreadPool::Shared().ParallelFor(image_data.num_images_, [&](int i) {
+		if (image_data.rects_[i].w == 0) {
+			return;
+		}
 
+		unsigned char* pixels = DecodeImage(paths[i], image_data.rects_[i], errors[i]);
+		if (pixels != nullptr) {
+			use_pixels(i, pixels);
+			stbi_image_free(pixels);
+		}
+	});
+	ReportErrors(paths, errors);
+}
+
+void GetImageData(const std::vector<std::string>& paths, ImageData& image_data)
+{
+	GetImageSizes(paths, image_data);
+	LoadImagePixels(paths, image_data);
 }
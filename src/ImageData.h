@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <array>
+#include <functional>
+#include <string>
 #include <unordered_set>
 
 struct Vec2
@@ -10,23 +12,46 @@ struct Vec2
 	int y = 0;
 };
 
+//w and h are always the size of the source image. rotated images are stored turned 90 degrees clockwise in the atlas,
+//so they take up h x w there
 struct Rect
 {
 	int x = 0;
 	int y = 0;
 	int w = 0;
 	int h = 0;
+	bool rotated = false;
 };
 
-constexpr int MAX_IMAGES = 512;
-
+//structure of arrays with one entry per image in each, so the packers run through rects_ alone. grows as images are
+//added, and the atlas pages are kept apart from the images
 struct ImageData
 {
-	Rect rects_[MAX_IMAGES];
-	unsigned char* data_[MAX_IMAGES] = { 0 };
-	std::string paths_[MAX_IMAGES];
+	//appends an image of this size without pixels and returns its index
+	int AddImage(const std::string& path, int w, int h);
+	//frees the pixels of every image and atlas page and removes them all
+	void Clear();
+
+	std::vector<Rect> rects_;
+	std::vector<unsigned char*> data_;
+	std::vector<std::string> paths_;
+	//atlas page each image was packed on
+	std::vector<int> pages_;
 
 	int num_images_ = 0;
+
+	//one entry per atlas page, created by AtlasPacker::CreateAtlas
+	std::vector<Rect> atlas_rects_;
+	std::vector<unsigned char*> atlas_data_;
 };
 
+//reads only the size of each image from its header and leaves data_ empty, so images can be packed before they are
+//decoded. failed images are left 0 x 0
+void GetImageSizes(const std::vector<std::string>& paths, ImageData& image_data);
+//decodes the pixels of images sized by GetImageSizes from the same paths into data_. images that fail to decode are
+//reported and left without pixels
+void LoadImagePixels(const std::vector<std::string>& paths, ImageData& image_data);
+//same, but hands each image to use_pixels on the thread that decoded it and frees it straight after instead of keeping
+//it in data_, so only the images being decoded are held in memory at once
+void LoadImagePixels(const std::vector<std::string>& paths, const ImageData& image_data, const std::function<void(int, const unsigned char*)>& use_pixels);
 void GetImageData(const std::vector<std::string>& paths, ImageData& image_data);
\ No newline at end of file
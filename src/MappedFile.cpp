@@ -0,0 +1,165 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//mapping a file and faulting its pages in costs more than copying a few pages of it, so smaller files are read instead
+constexpr long long MIN_MAPPED_SIZE = 64 * 1024;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& path)
+{
+	//narrow path, same as the fopen inside stbi_load
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+		CloseHandle(file);
+		return;
+	}
+
+	if (size.QuadPart < MIN_MAPPED_SIZE) {
+		buffer_.resize((size_t)size.QuadPart);
+		DWORD num_read = 0;
+		if (ReadFile(file, buffer_.data(), (DWORD)buffer_.size(), &num_read, nullptr) && num_read == buffer_.size()) {
+			data_ = buffer_.data();
+			size_ = buffer_.size();
+		}
+	}
+	//the view stays valid once the mapping and the file are closed
+	else {
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping != nullptr) {
+			data_ = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			size_ = data_ != nullptr ? (size_t)size.QuadPart : 0;
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data_ != nullptr && buffer_.empty()) {
+		UnmapViewOfFile(data_);
+	}
+}
+
+//PrefetchVirtualMemory only exists from windows 8 on, so it is looked up when first needed instead of linked to
+using PrefetchVirtualMemoryFunc = BOOL(WINAPI*)(HANDLE process, ULONG_PTR num_ranges, void* ranges, ULONG flags);
+
+//same layout as WIN32_MEMORY_RANGE_ENTRY, which the headers only declare when targeting windows 8
+struct MemoryRange
+{
+	void* address;
+	SIZE_T num_bytes;
+};
+
+static PrefetchVirtualMemoryFunc GetPrefetchVirtualMemory()
+{
+	static const PrefetchVirtualMemoryFunc prefetch = (PrefetchVirtualMemoryFunc)(void*)GetProcAddress(GetModuleHandleA("kernel32.dll"), "PrefetchVirtualMemory");
+	return prefetch;
+}
+
+void MappedFile::WillNeed(const std::string& path)
+{
+	//windows has no hint for a file that is not mapped, so the file is mapped just to prefetch the view. the pages are
+	//read into the file cache in the background, and stay there once the view is unmapped for the next open to find
+	PrefetchVirtualMemoryFunc prefetch = GetPrefetchVirtualMemory();
+	if (prefetch == nullptr) {
+		return;
+	}
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+
+	LARGE_INTEGER size;
+	HANDLE mapping = nullptr;
+	if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	}
+	if (mapping != nullptr) {
+		void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (view != nullptr) {
+			MemoryRange range = { view, (SIZE_T)size.QuadPart };
+			prefetch(GetCurrentProcess(), 1, &range, 0);
+			UnmapViewOfFile(view);
+		}
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path)
+{
+	int file = open(path.c_str(), O_RDONLY);
+	if (file == -1) {
+		return;
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size <= 0) {
+		close(file);
+		return;
+	}
+
+	if (info.st_size < MIN_MAPPED_SIZE) {
+		buffer_.resize(info.st_size);
+		size_t num_read = 0;
+		while (num_read < buffer_.size()) {
+			ssize_t result = read(file, buffer_.data() + num_read, buffer_.size() - num_read);
+			if (result <= 0) {
+				break;
+			}
+			num_read += result;
+		}
+		if (num_read == buffer_.size()) {
+			data_ = buffer_.data();
+			size_ = buffer_.size();
+		}
+	}
+	//the mapping stays valid once the file is closed
+	else {
+		void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data != MAP_FAILED) {
+			data_ = (const unsigned char*)data;
+			size_ = info.st_size;
+		}
+	}
+	close(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (data_ != nullptr && buffer_.empty()) {
+		munmap((void*)data_, size_);
+	}
+}
+
+void MappedFile::WillNeed(const std::string& path)
+{
+#ifdef POSIX_FADV_WILLNEED
+	int file = open(path.c_str(), O_RDONLY);
+	if (file != -1) {
+		posix_fadvise(file, 0, 0, POSIX_FADV_WILLNEED);
+		close(file);
+	}
+#endif
+}
+
+#endif
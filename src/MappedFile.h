@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//whole file mapped read only into memory, so it is read straight out of the page cache instead of being copied through
+//a stdio buffer. files too small for that to pay off are read into a buffer in one call instead. Data is nullptr if the
+//file could not be opened or is empty
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::string& path);
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const unsigned char* Data() const { return data_; }
+	size_t Size() const { return size_; }
+
+	//tells the system the whole file will be read soon, so it can start reading it in while other files are still being
+	//worked on. nothing is kept open, so any number of files can be hinted at once. does nothing before windows 8
+	static void WillNeed(const std::string& path);
+
+private:
+	const unsigned char* data_ = nullptr;
+	size_t size_ = 0;
+	//holds small files, empty if the file is mapped
+	std::vector<unsigned char> buffer_;
+};
\ No newline at end of file
@@ -1,81 +1,385 @@
 #include "MaxRects.h"
 
-static int pixel_padding_ = 0;
-static std::vector<Rect> free_rects_;
+#include "FitKernel.h"
 
-bool MaxRects::PackAtlas(ImageData& images, Vec2 size, std::vector<int>& sorted_indices, int padding)
+#include <algorithm>
+#include <cmath>
+
+//grid is kept coarse so that the large free rects early on only need to be added to a few cells
+constexpr int MAX_GRID_CELLS_PER_SIDE = 32;
+//every image placed splits the free rects under the edge of the images packed so far, and that edge gets more ragged
+//the more images fit across the atlas. past this many images, the atlas is split into columns about
+//COLUMN_WIDTH_IN_IMAGES average images wide. free rects never cross a column, so placing an image takes about the
+//same time however many there are, for a little space lost at the column edges
+constexpr int MIN_IMAGES_FOR_COLUMNS = 2048;
+constexpr int COLUMN_WIDTH_IN_IMAGES = 32;
+
+bool MaxRects::PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, MaxRectsHeuristic heuristic, bool allow_rotation, int num_columns, const std::atomic<bool>* cancelled)
 {
-	pixel_padding_ = padding;
+	size_ = { size.x + padding, size.y + padding };
+	used_rects_.clear();
 
 	//start with whole atlas being available
-	free_rects_.clear();
-	free_rects_.push_back({ 0,0, size.x, size.y });
+	ResetFreeRects(size_, sorted_indices.size());
+	if (size.x > 0 && size.y > 0) {
+		num_columns = GetNumColumns(rects, sorted_indices, size.x, padding, allow_rotation, num_columns);
+		for (int column = 0; column < num_columns; ++column) {
+			int left = (int)((long long)size_.x * column / num_columns);
+			int right = (int)((long long)size_.x * (column + 1) / num_columns);
+			AddFreeRect({ left, 0, right - left, size_.y });
+		}
+	}
 
-	for (int image = 0; image < images.num_images_; ++image) {
+	failed_image_ = 0;
+	return PackRemaining(rects, sorted_indices, padding, heuristic, allow_rotation, cancelled);
+}
 
-		if (free_rects_.empty()) {
+bool MaxRects::ResumeTaller(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, MaxRectsHeuristic heuristic, bool allow_rotation, int num_columns, const std::atomic<bool>* cancelled)
+{
+	//an atlas without height never had a free rect to stretch
+	//columns cover the new rows on their own, which this does not keep track of
+	if (failed_image_ == -1 || heuristic != MaxRectsHeuristic::BottomLeft || allow_rotation ||
+		size.x + padding != size_.x || size.y + padding < size_.y || size_.x <= padding || size_.y <= padding ||
+		GetNumColumns(rects, sorted_indices, size.x, padding, allow_rotation, num_columns) > 1) {
+		return PackAtlas(rects, size, sorted_indices, padding, heuristic, allow_rotation, num_columns, cancelled);
+	}
+
+	//every image is placed above the old bottom edge, and newly fitting spots reach below it, so none of them can score
+	//better than a spot that fit before. stretched rects stay in the grid cells of the last row, which the grid clamps
+	//anything below the old edge to
+	int old_height = size_.y;
+	size_.y = size.y + padding;
+
+	bool covers_new_rows = false;
+	for (int slot = 0; slot < order_.size(); ++slot) {
+		if (order_[slot] >= 0 && free_y_[slot] + free_h_[slot] == old_height) {
+			free_h_[slot] = size_.y - free_y_[slot];
+			covers_new_rows |= free_x_[slot] == 0 && free_w_[slot] == size_.x;
+		}
+	}
+
+	if (!covers_new_rows && size_.y > old_height) {
+		AddFreeRect({ 0, old_height, size_.x, size_.y - old_height });
+	}
+
+	return PackRemaining(rects, sorted_indices, padding, heuristic, allow_rotation, cancelled);
+}
+
+bool MaxRects::PackRemaining(Rect* rects, const std::vector<int>& sorted_indices, int padding, MaxRectsHeuristic heuristic, bool allow_rotation, const std::atomic<bool>* cancelled)
+{
+	//nothing changes until an image is placed, so after a failure everything is still as it was before the failed image
+	for (; failed_image_ < sorted_indices.size(); ++failed_image_) {
+
+		if (num_free_rects_ == 0 || (cancelled != nullptr && *cancelled)) {
 			return false;
 		}
 
-		int curr_idx = sorted_indices[image];
+		int curr_idx = sorted_indices[failed_image_];
+		Rect padded = { 0, 0, rects[curr_idx].w + padding, rects[curr_idx].h + padding };
 
-		int best_short_side_fit = 4096;
-		int best_fit_index = 0;
-		for (int i = 0; i < free_rects_.size(); ++i) {
-			int leftover_width = free_rects_[i].w - images.rects_[curr_idx].w;
-			int leftover_height = free_rects_[i].h - images.rects_[curr_idx].h;
-			int shortest_side = std::min(leftover_width, leftover_height);
+		int best_fit_index = FindBestFit(padded, heuristic);
+		rects[curr_idx].rotated = false;
 
-			//if shortest side < 0 then image did not fit into free rect
-			if (shortest_side >= 0 && shortest_side < best_short_side_fit) {
-				best_short_side_fit = shortest_side;
-				best_fit_index = i;
+		if (allow_rotation && padded.w != padded.h) {
+			Rect turned = { 0, 0, padded.h, padded.w };
+			int turned_index = FindBestFit(turned, heuristic);
+			if (turned_index != -1 && (best_fit_index == -1 || IsBetterFit(turned_index, turned, best_fit_index, padded, heuristic))) {
+				best_fit_index = turned_index;
+				padded = turned;
+				rects[curr_idx].rotated = true;
 			}
 		}
 
 		//didnt find any fits
-		if (best_short_side_fit == 4096) {
+		if (best_fit_index == -1) {
 			return false;
 		}
 
-		images.rects_[curr_idx].x = free_rects_[best_fit_index].x;
-		images.rects_[curr_idx].y = free_rects_[best_fit_index].y;
+		padded.x = rects[curr_idx].x = free_x_[best_fit_index];
+		padded.y = rects[curr_idx].y = free_y_[best_fit_index];
+		used_rects_.push_back(padded);
 
-		//used to not waste time going over the new split rects that are added
-		int num_rects_left = free_rects_.size();
-		for (int i = 0; i < num_rects_left; ++i) {
-			if (IntersectsRect(images.rects_[curr_idx], free_rects_[i])) {
-				//split intersected free rects into at most 4 new smaller rects
-				PushSplitRects(images.rects_[curr_idx], free_rects_[i]);
+		//only free rects in the grid cells under the image can intersect it. they are split in the order they were added
+		//so the new rects come out in the same order as when walking the whole list
+		QueryGrid(padded, query_slots_);
+		query_slots_.erase(std::remove_if(query_slots_.begin(), query_slots_.end(), [&](int slot) { return !IntersectsRect(padded, GetFreeRect(slot)); }), query_slots_.end());
+		std::sort(query_slots_.begin(), query_slots_.end(), [this](int a, int b) { return order_[a] < order_[b]; });
 
-				free_rects_.erase(free_rects_.begin() + i);
-				--i;
-				--num_rects_left;
-			}
+		//split intersected free rects into at most 4 new smaller rects
+		split_rects_.clear();
+		for (int slot : query_slots_) {
+			PushSplitRects(padded, GetFreeRect(slot));
+			RemoveFreeRect(slot);
 		}
 
-		//prune any free rects that are completely enclosed within another
-		for (int i = 0; i < free_rects_.size(); ++i) {
-			for (int j = i + 1; j < free_rects_.size(); ++j) {
-				//if j is enclosed in k, remove j
-				if (EnclosedInRect(free_rects_[i], free_rects_[j])) {
-					free_rects_.erase(free_rects_.begin() + i);
-					--i;
+		//remaining free rects were not enclosed in each other before the split, and every new rect lies within a removed
+		//one, so only the new rects have to be checked. any free rect enclosing a new rect covers its top left corner
+		split_removed_.assign(split_rects_.size(), false);
+		for (int i = 0; i < split_rects_.size(); ++i) {
+			QueryGrid({ split_rects_[i].x, split_rects_[i].y, 1, 1 }, query_slots_);
+			for (int slot : query_slots_) {
+				if (EnclosedInRect(split_rects_[i], GetFreeRect(slot))) {
+					split_removed_[i] = true;
 					break;
 				}
-				//vice versa
-				else if (EnclosedInRect(free_rects_[j], free_rects_[i])) {
-					free_rects_.erase(free_rects_.begin() + j);
-					--j;
+			}
+
+			//of identical rects only the last one is kept, matching the order a full pairwise prune leaves them in
+			for (int j = 0; j < split_rects_.size() && !split_removed_[i]; ++j) {
+				if (j != i && EnclosedInRect(split_rects_[i], split_rects_[j]) && (j > i || !EnclosedInRect(split_rects_[j], split_rects_[i]))) {
+					split_removed_[i] = true;
 				}
+			}
+		}
 
+		for (int i = 0; i < split_rects_.size(); ++i) {
+			if (!split_removed_[i]) {
+				AddFreeRect(split_rects_[i]);
 			}
 		}
 	}
 
+	failed_image_ = -1;
 	return true;
 }
 
+int MaxRects::GetNumColumns(const Rect* rects, const std::vector<int>& sorted_indices, int width, int padding, bool allow_rotation, int num_columns)
+{
+	if (num_columns <= 0 && sorted_indices.size() < MIN_IMAGES_FOR_COLUMNS) {
+		return 1;
+	}
+
+	//every image has to fit in a column, turned if it can be
+	long long total_width = 0;
+	int widest = 1;
+	for (int i : sorted_indices) {
+		int image_width = (allow_rotation ? std::min(rects[i].w, rects[i].h) : rects[i].w) + padding;
+		total_width += image_width;
+		widest = std::max(widest, image_width);
+	}
+
+	int padded_width = width + padding;
+	if (num_columns <= 0) {
+		double average_width = std::max(total_width / (double)sorted_indices.size(), 1.0);
+		num_columns = (int)(padded_width / (average_width * COLUMN_WIDTH_IN_IMAGES));
+	}
+	return std::clamp(num_columns, 1, std::max(padded_width / widest, 1));
+}
+
+int MaxRects::FindBestFit(const Rect& image, MaxRectsHeuristic heuristic)
+{
+	//default heuristic is the innermost loop of the whole packer, so it gets its own simd kernel
+	if (heuristic == MaxRectsHeuristic::BestShortSideFit) {
+		return FindBestShortSideFit(free_w_.data(), free_h_.data(), order_.data(), order_.size(), image.w, image.h);
+	}
+
+	//lower scores are better. secondary score breaks ties, then the oldest free rect wins
+	int best_fit_index = -1;
+	long long best_score = 0;
+	long long best_secondary_score = 0;
+
+	for (int i = 0; i < order_.size(); ++i) {
+		//skip empty slots and free rects the image does not fit into
+		if (order_[i] < 0 || free_w_[i] < image.w || free_h_[i] < image.h) {
+			continue;
+		}
+
+		long long score = 0;
+		long long secondary_score = 0;
+		ScoreFit(i, image, heuristic, score, secondary_score);
+
+		if (best_fit_index == -1 || score < best_score ||
+			(score == best_score && (secondary_score < best_secondary_score || (secondary_score == best_secondary_score && order_[i] < order_[best_fit_index])))) {
+			best_fit_index = i;
+			best_score = score;
+			best_secondary_score = secondary_score;
+		}
+	}
+
+	return best_fit_index;
+}
+
+void MaxRects::ScoreFit(int slot, const Rect& image, MaxRectsHeuristic heuristic, long long& score, long long& secondary_score) const
+{
+	int leftover_width = free_w_[slot] - image.w;
+	int leftover_height = free_h_[slot] - image.h;
+
+	score = 0;
+	secondary_score = 0;
+	switch (heuristic) {
+		case MaxRectsHeuristic::BestShortSideFit: {
+			score = std::min(leftover_width, leftover_height);
+			break;
+		}
+		case MaxRectsHeuristic::BestLongSideFit: {
+			score = std::max(leftover_width, leftover_height);
+			secondary_score = std::min(leftover_width, leftover_height);
+			break;
+		}
+		case MaxRectsHeuristic::BestAreaFit: {
+			score = (long long)free_w_[slot] * free_h_[slot] - (long long)image.w * image.h;
+			secondary_score = std::min(leftover_width, leftover_height);
+			break;
+		}
+		case MaxRectsHeuristic::BottomLeft: {
+			score = free_y_[slot] + image.h;
+			secondary_score = free_x_[slot];
+			break;
+		}
+		default: {
+			//most touching edges is best
+			score = -ContactScore({ free_x_[slot], free_y_[slot], image.w, image.h });
+			break;
+		}
+	}
+}
+
+bool MaxRects::IsBetterFit(int slot, const Rect& image, int other_slot, const Rect& other_image, MaxRectsHeuristic heuristic) const
+{
+	long long score, secondary_score, other_score, other_secondary_score;
+	ScoreFit(slot, image, heuristic, score, secondary_score);
+	ScoreFit(other_slot, other_image, heuristic, other_score, other_secondary_score);
+
+	if (score != other_score) {
+		return score < other_score;
+	}
+	if (secondary_score != other_secondary_score) {
+		return secondary_score < other_secondary_score;
+	}
+	return order_[slot] < order_[other_slot];
+}
+
+int MaxRects::ContactScore(const Rect& rect) const
+{
+	auto common_length = [](int a_start, int a_end, int b_start, int b_end) { return std::max(0, std::min(a_end, b_end) - std::max(a_start, b_start)); };
+
+	int score = 0;
+	if (rect.x == 0 || rect.x + rect.w == size_.x) {
+		score += rect.h;
+	}
+	if (rect.y == 0 || rect.y + rect.h == size_.y) {
+		score += rect.w;
+	}
+
+	for (const Rect& used : used_rects_) {
+		if (used.x == rect.x + rect.w || used.x + used.w == rect.x) {
+			score += common_length(used.y, used.y + used.h, rect.y, rect.y + rect.h);
+		}
+		if (used.y == rect.y + rect.h || used.y + used.h == rect.y) {
+			score += common_length(used.x, used.x + used.w, rect.x, rect.x + rect.w);
+		}
+	}
+
+	return score;
+}
+
+void MaxRects::ResetFreeRects(Vec2 size, int num_images)
+{
+	free_x_.clear();
+	free_y_.clear();
+	free_w_.clear();
+	free_h_.clear();
+	order_.clear();
+	empty_slots_.clear();
+	visited_.clear();
+	num_free_rects_ = 0;
+	next_order_ = 0;
+	visit_stamp_ = 0;
+
+	//the free list grows roughly with the number of images, so aim for a few free rects per cell
+	int cells_per_side = std::clamp((int)std::sqrt(num_images), 1, MAX_GRID_CELLS_PER_SIDE);
+	int longest_side = std::max(size.x, size.y);
+	cell_size_ = std::max(1, (longest_side + cells_per_side - 1) / cells_per_side);
+	num_cols_ = std::max(1, (size.x + cell_size_ - 1) / cell_size_);
+	num_rows_ = std::max(1, (size.y + cell_size_ - 1) / cell_size_);
+
+	//clear rather than reassign so each cell keeps its capacity between attempts
+	if (cells_.size() < (size_t)num_cols_ * num_rows_) {
+		cells_.resize((size_t)num_cols_ * num_rows_);
+	}
+	for (auto& cell : cells_) {
+		cell.clear();
+	}
+}
+
+void MaxRects::AddFreeRect(const Rect& rect)
+{
+	int slot;
+	if (empty_slots_.empty()) {
+		slot = order_.size();
+		free_x_.push_back(0);
+		free_y_.push_back(0);
+		free_w_.push_back(0);
+		free_h_.push_back(0);
+		order_.push_back(0);
+		visited_.push_back(0);
+	}
+	else {
+		slot = empty_slots_.back();
+		empty_slots_.pop_back();
+	}
+
+	free_x_[slot] = rect.x;
+	free_y_[slot] = rect.y;
+	free_w_[slot] = rect.w;
+	free_h_[slot] = rect.h;
+	order_[slot] = next_order_;
+
+	int first_col = std::min(rect.x / cell_size_, num_cols_ - 1);
+	int last_col = std::min((rect.x + rect.w - 1) / cell_size_, num_cols_ - 1);
+	int first_row = std::min(rect.y / cell_size_, num_rows_ - 1);
+	int last_row = std::min((rect.y + rect.h - 1) / cell_size_, num_rows_ - 1);
+	for (int row = first_row; row <= last_row; ++row) {
+		for (int col = first_col; col <= last_col; ++col) {
+			cells_[row * num_cols_ + col].push_back({ slot, next_order_ });
+		}
+	}
+
+	++next_order_;
+	++num_free_rects_;
+}
+
+void MaxRects::RemoveFreeRect(int slot)
+{
+	//a negative size means the slot never fits an image, so the fit kernel needs no separate check for empty slots
+	free_w_[slot] = -1;
+	free_h_[slot] = -1;
+	order_[slot] = -1;
+	empty_slots_.push_back(slot);
+	--num_free_rects_;
+}
+
+void MaxRects::QueryGrid(const Rect& area, std::vector<int>& slots)
+{
+	slots.clear();
+	++visit_stamp_;
+
+	//a zero sized area still covers the cell it sits in
+	int first_col = std::min(area.x / cell_size_, num_cols_ - 1);
+	int last_col = std::min(std::max(area.x, area.x + area.w - 1) / cell_size_, num_cols_ - 1);
+	int first_row = std::min(area.y / cell_size_, num_rows_ - 1);
+	int last_row = std::min(std::max(area.y, area.y + area.h - 1) / cell_size_, num_rows_ - 1);
+	for (int row = first_row; row <= last_row; ++row) {
+		for (int col = first_col; col <= last_col; ++col) {
+			auto& cell = cells_[row * num_cols_ + col];
+			for (int i = 0; i < cell.size();) {
+				GridEntry entry = cell[i];
+				if (order_[entry.slot] != entry.order) {
+					cell[i] = cell.back();
+					cell.pop_back();
+					continue;
+				}
+
+				if (visited_[entry.slot] != visit_stamp_) {
+					visited_[entry.slot] = visit_stamp_;
+					slots.push_back(entry.slot);
+				}
+				++i;
+			}
+		}
+	}
+}
+
 bool MaxRects::IntersectsRect(const Rect& new_rect, const Rect& free_rect)
 {
 	//separating axis theorem
@@ -87,36 +391,36 @@ bool MaxRects::IntersectsRect(const Rect& new_rect, const Rect& free_rect)
 	return true;
 }
 
-void MaxRects::PushSplitRects(const Rect& new_rect, const Rect& free_rect)
+void MaxRects::PushSplitRects(const Rect& new_rect, Rect free_rect)
 {
 	//top rect
 	if (new_rect.y > free_rect.y) {
 		Rect temp = free_rect;
-		temp.h = new_rect.y - free_rect.y - pixel_padding_;
-		free_rects_.push_back(temp);
+		temp.h = new_rect.y - free_rect.y;
+		split_rects_.push_back(temp);
 	}
 
 	//bottom rect
 	if (free_rect.y + free_rect.h > new_rect.y + new_rect.h) {
 		Rect temp = free_rect;
-		temp.y = new_rect.y + new_rect.h + pixel_padding_;
-		temp.h = free_rect.y + free_rect.h - (new_rect.y + new_rect.h) - pixel_padding_;
-		free_rects_.push_back(temp);
+		temp.y = new_rect.y + new_rect.h;
+		temp.h = free_rect.y + free_rect.h - (new_rect.y + new_rect.h);
+		split_rects_.push_back(temp);
 	}
 
 	//left rect
 	if (new_rect.x > free_rect.x) {
 		Rect temp = free_rect;
-		temp.w = new_rect.x - free_rect.x - pixel_padding_;
-		free_rects_.push_back(temp);
+		temp.w = new_rect.x - free_rect.x;
+		split_rects_.push_back(temp);
 	}
 
 	//right rect
 	if (free_rect.x + free_rect.w > new_rect.x + new_rect.w) {
 		Rect temp = free_rect;
-		temp.x = new_rect.x + new_rect.w + pixel_padding_;
-		temp.w = free_rect.x + free_rect.w - (new_rect.x + new_rect.w) - pixel_padding_;
-		free_rects_.push_back(temp);
+		temp.x = new_rect.x + new_rect.w;
+		temp.w = free_rect.x + free_rect.w - (new_rect.x + new_rect.w);
+		split_rects_.push_back(temp);
 	}
 }
 
@@ -2,12 +2,91 @@
 
 #include "ImageData.h"
 
+#include <atomic>
+#include <vector>
+
+//rule used to choose which free rect an image is placed in. y grows downwards, so BottomLeft fills the atlas from the top left corner
+enum class MaxRectsHeuristic
+{
+	BestShortSideFit,
+	BestLongSideFit,
+	BestAreaFit,
+	BottomLeft,
+	ContactPoint,
+	//packs with every heuristic above at the same time and keeps the smallest atlas
+	Best
+};
+
+constexpr int NUM_MAX_RECTS_HEURISTICS = (int)MaxRectsHeuristic::Best;
+
+//each instance owns its own free list so separate instances can pack concurrently.
+//the free list is kept between calls to avoid reallocating it on every attempt
 class MaxRects
 {
 public:
-	static bool PackAtlas(ImageData& images, Vec2 size, std::vector<int>& sorted_indices, int padding);
+	//places rects in sorted_indices order, turning them when that scores better if allow_rotation is set. num_columns
+	//is passed on to GetNumColumns. stops early and returns false if cancelled is set while packing
+	bool PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, MaxRectsHeuristic heuristic, bool allow_rotation, int num_columns, const std::atomic<bool>* cancelled = nullptr);
+	//carries on from the first image the last call could not place, in an atlas of the same width that is at least as
+	//tall. the free rects on the bottom edge are stretched down to the new edge and the new rows are added as a free
+	//rect, which gives the same free space as packing from the start. only BottomLeft without rotation is guaranteed to
+	//place every image the same way in that space, since the other heuristics score the stretched rects differently,
+	//so anything else packs from the start. rects and settings must be the same as in the last call
+	bool ResumeTaller(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, MaxRectsHeuristic heuristic, bool allow_rotation, int num_columns, const std::atomic<bool>* cancelled = nullptr);
+	//number of columns an atlas this wide is split into, 1 unless there are very many images. if num_columns is above 0
+	//that many are used whatever the number of images, as long as the widest image still fits in a column
+	static int GetNumColumns(const Rect* rects, const std::vector<int>& sorted_indices, int width, int padding, bool allow_rotation, int num_columns = 0);
 private:
+	struct GridEntry
+	{
+		int slot = 0;
+		int order = 0;
+	};
+
+	bool PackRemaining(Rect* rects, const std::vector<int>& sorted_indices, int padding, MaxRectsHeuristic heuristic, bool allow_rotation, const std::atomic<bool>* cancelled);
 	static bool IntersectsRect(const Rect& new_rect, const Rect& free_rect);
-	static void PushSplitRects(const Rect& new_rect, const Rect& free_rect);
+	void PushSplitRects(const Rect& new_rect, Rect free_rect);
 	static bool EnclosedInRect(const Rect& a, const Rect& b);
+
+	int FindBestFit(const Rect& image, MaxRectsHeuristic heuristic);
+	void ScoreFit(int slot, const Rect& image, MaxRectsHeuristic heuristic, long long& score, long long& secondary_score) const;
+	bool IsBetterFit(int slot, const Rect& image, int other_slot, const Rect& other_image, MaxRectsHeuristic heuristic) const;
+	int ContactScore(const Rect& rect) const;
+
+	void ResetFreeRects(Vec2 size, int num_images);
+	void AddFreeRect(const Rect& rect);
+	void RemoveFreeRect(int slot);
+	void QueryGrid(const Rect& area, std::vector<int>& slots);
+
+	Vec2 size_;
+	std::vector<Rect> used_rects_;
+	//first image not placed yet, -1 once every image is
+	int failed_image_ = -1;
+
+	Rect GetFreeRect(int slot) const { return { free_x_[slot], free_y_[slot], free_w_[slot], free_h_[slot] }; }
+
+	//free rects stay in the same slot until removed so the grid can refer to them by index. they are stored as separate
+	//arrays so the fit search can score several at once. order_ is the order each rect was added in, which breaks best
+	//fit ties the same way a plain list would. empty slots have an order and size of -1
+	std::vector<int> free_x_;
+	std::vector<int> free_y_;
+	std::vector<int> free_w_;
+	std::vector<int> free_h_;
+	std::vector<int> order_;
+	std::vector<int> empty_slots_;
+	int num_free_rects_ = 0;
+	int next_order_ = 0;
+
+	//uniform grid over the atlas. each cell lists the free rects that overlap it. removed rects are left in the
+	//cells and dropped the next time the cell is queried, since their order no longer matches the slot
+	std::vector<std::vector<GridEntry>> cells_;
+	int cell_size_ = 1;
+	int num_cols_ = 0;
+	int num_rows_ = 0;
+
+	std::vector<Rect> split_rects_;
+	std::vector<bool> split_removed_;
+	std::vector<int> query_slots_;
+	std::vector<int> visited_;
+	int visit_stamp_ = 0;
 };
\ No newline at end of file
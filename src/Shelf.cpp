@@ -0,0 +1,334 @@
+#include "Shelf.h"
+
+#include <algorithm>
+
+bool Shelf::PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, ShelfRule rule)
+{
+	failed_image_ = 0;
+	rule_ = rule;
+	pen_x_ = 0;
+	pen_y_ = 0;
+	//the first shelf is as tall as the first image, which is the tallest when sorted by height
+	shelf_height_ = allow_rotation || sorted_indices.empty() ? 0 : rects[sorted_indices[0]].h;
+
+	shelves_.clear();
+	if (rule == ShelfRule::FirstFit) {
+		//every shelf starts with an image on it, so there are never more shelves than images
+		free_widths_.Reset(sorted_indices.size());
+	}
+	else if (rule == ShelfRule::BestHeightFit) {
+		//shelves are never taller than the tallest image
+		int max_height = 0;
+		for (int i : sorted_indices) {
+			max_height = std::max(max_height, (allow_rotation ? std::max(rects[i].w, rects[i].h) : rects[i].h) + padding);
+		}
+		free_widths_.Reset(max_height + 1);
+		for (std::set<std::pair<int, int>>& same_height : shelves_by_height_) {
+			same_height.clear();
+		}
+		shelves_by_height_.resize(max_height + 1);
+	}
+
+	return PackRemaining(rects, size, sorted_indices, padding, allow_rotation);
+}
+
+bool Shelf::ResumeTaller(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, ShelfRule rule)
+{
+	//open shelves only take images that fit in their width, and a shelf is only started below the last when none
+	//does, so every rule places images the same way whatever the atlas height
+	if (failed_image_ == -1 || rule != rule_ || size.x != size_.x || size.y < size_.y) {
+		return PackAtlas(rects, size, sorted_indices, padding, allow_rotation, rule);
+	}
+
+	return PackRemaining(rects, size, sorted_indices, padding, allow_rotation);
+}
+
+bool Shelf::PackRemaining(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation)
+{
+	size_ = size;
+	bool packed;
+	if (rule_ != ShelfRule::NextFit) {
+		packed = PackOpenShelves(rects, size, sorted_indices, padding, allow_rotation);
+	}
+	else {
+		packed = allow_rotation ? PackShelvesRotated(rects, size, sorted_indices, padding) : PackShelves(rects, size, sorted_indices, padding);
+	}
+	if (packed) {
+		failed_image_ = -1;
+	}
+	return packed;
+}
+
+bool Shelf::PackShelves(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding)
+{
+	//the pen only moves once an image is placed, so after a failure it is still where the failed image started from
+	for (; failed_image_ < sorted_indices.size(); ++failed_image_) {
+		Rect& rect = rects[sorted_indices[failed_image_]];
+		int pen_x = pen_x_, pen_y = pen_y_;
+		int shelf_height = shelf_height_;
+
+		//the pen is already past the padding after the last image, and the padding after this one can fall outside the
+		//atlas, so an image that reaches exactly to the edge still fits
+		while (pen_x + rect.w > size.x) {
+			pen_x = 0;
+			pen_y += shelf_height + padding;
+			shelf_height = rect.h;
+
+			//unable to fit everything in atlas
+			if (pen_y + rect.h > size.y) {
+				return false;
+			}
+		}
+
+		//only the first image of a shelf is the tallest when sorted by height, so with other orders the shelf grows to fit
+		shelf_height = std::max(shelf_height, rect.h);
+		if (pen_y + rect.h > size.y) {
+			return false;
+		}
+
+		rect.x = pen_x;
+		rect.y = pen_y;
+		rect.rotated = false;
+
+		pen_x_ = pen_x + rect.w + padding;
+		pen_y_ = pen_y;
+		shelf_height_ = shelf_height;
+	}
+
+	return true;
+}
+
+bool Shelf::PackShelvesRotated(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding)
+{
+	//sorted by their short side, every image fits lying flat on the current shelf. each shelf is as tall as the short
+	//side of its first image, and images stand up instead whenever their long side also fits under it
+	for (; failed_image_ < sorted_indices.size(); ++failed_image_) {
+		Rect& rect = rects[sorted_indices[failed_image_]];
+		int pen_x = pen_x_, pen_y = pen_y_;
+		int shelf_height = shelf_height_;
+
+		int short_side = std::min(rect.w, rect.h);
+		int long_side = std::max(rect.w, rect.h);
+
+		bool stand_up = long_side <= shelf_height;
+		int width = stand_up ? short_side : long_side;
+		int height = stand_up ? long_side : short_side;
+
+		if (failed_image_ == 0 || pen_x + width > size.x) {
+			if (failed_image_ > 0) {
+				pen_y += shelf_height + padding;
+			}
+			pen_x = 0;
+
+			//only stands up on a new shelf if it is too long to lie flat across the atlas
+			width = long_side > size.x ? short_side : long_side;
+			height = long_side > size.x ? long_side : short_side;
+			shelf_height = height;
+
+			//unable to fit everything in atlas
+			if (width > size.x || pen_y + height > size.y) {
+				return false;
+			}
+		}
+		else if (height > shelf_height) {
+			//with other orders than by short side, the shelf grows to fit an image lying flat
+			shelf_height = height;
+			if (pen_y + height > size.y) {
+				return false;
+			}
+		}
+
+		rect.x = pen_x;
+		rect.y = pen_y;
+		rect.rotated = width != rect.w;
+
+		pen_x_ = pen_x + width + padding;
+		pen_y_ = pen_y;
+		shelf_height_ = shelf_height;
+	}
+
+	return true;
+}
+
+bool Shelf::PackOpenShelves(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation)
+{
+	padded_size_ = { size.x + padding, size.y + padding };
+
+	//shelves only change once an image is placed, so after a failure they are as the failed image found them
+	for (; failed_image_ < sorted_indices.size(); ++failed_image_) {
+		Rect& rect = rects[sorted_indices[failed_image_]];
+		Vec2 image = { rect.w + padding, rect.h + padding };
+
+		//standing on its short side an image takes up the least width of a shelf, lying flat the least height
+		Vec2 standing = image, lying = image;
+		if (allow_rotation) {
+			standing = { std::min(image.x, image.y), std::max(image.x, image.y) };
+			lying = { standing.y, standing.x };
+		}
+
+		Vec2 placed = standing;
+		int shelf = FindShelf(standing);
+		if (lying.x != standing.x) {
+			int lying_shelf = FindShelf(lying);
+			if (lying_shelf != -1 && (shelf == -1 || IsBetterShelf(lying_shelf, lying, shelf, standing))) {
+				shelf = lying_shelf;
+				placed = lying;
+			}
+		}
+
+		if (shelf == -1) {
+			//same as next fit, only stands up on a new shelf if it is too long to lie flat across the atlas
+			placed = lying.x <= padded_size_.x ? lying : standing;
+			shelf = MakeRoom(placed);
+
+			//unable to fit everything in atlas
+			if (shelf == -1) {
+				return false;
+			}
+		}
+
+		OpenShelf old_shelf = shelves_[shelf];
+		rect.x = old_shelf.width;
+		rect.y = old_shelf.y;
+		rect.rotated = placed.x != image.x;
+		shelves_[shelf].width += placed.x;
+		UpdateIndex(shelf, old_shelf);
+	}
+
+	return true;
+}
+
+int Shelf::FindShelf(Vec2 image) const
+{
+	if (rule_ == ShelfRule::FirstFit) {
+		//sorted by height every shelf is tall enough, so the first shelf with the free width is the one. with other
+		//orders, shelves too short for the image are stepped past
+		for (int shelf = free_widths_.FindFirst(0, image.x); shelf != -1; shelf = free_widths_.FindFirst(shelf + 1, image.x)) {
+			if (shelves_[shelf].height >= image.y) {
+				return shelf;
+			}
+		}
+		return -1;
+	}
+
+	//the shortest height with a shelf that has the free width, and the shelf of that height with the least to spare
+	int height = free_widths_.FindFirst(image.y, image.x);
+	if (height == -1) {
+		return -1;
+	}
+	return shelves_by_height_[height].lower_bound({ image.x, -1 })->second;
+}
+
+bool Shelf::IsBetterShelf(int shelf, Vec2 image, int other_shelf, Vec2 other_image) const
+{
+	if (rule_ == ShelfRule::FirstFit) {
+		return shelf < other_shelf;
+	}
+	return shelves_[shelf].height - image.y < shelves_[other_shelf].height - other_image.y;
+}
+
+int Shelf::MakeRoom(Vec2 image)
+{
+	//the last shelf has no shelf below it, so it can grow to fit an image taller than it. that takes less height than
+	//starting a new shelf, the same as next fit does with other orders than by height
+	if (!shelves_.empty()) {
+		int last = shelves_.size() - 1;
+		if (shelves_[last].width + image.x <= padded_size_.x && shelves_[last].height < image.y) {
+			if (shelves_[last].y + image.y > padded_size_.y) {
+				return -1;
+			}
+			OpenShelf old_shelf = shelves_[last];
+			shelves_[last].height = image.y;
+			UpdateIndex(last, old_shelf);
+			return last;
+		}
+	}
+
+	int y = shelves_.empty() ? 0 : shelves_.back().y + shelves_.back().height;
+	if (image.x > padded_size_.x || y + image.y > padded_size_.y) {
+		return -1;
+	}
+	shelves_.push_back({ y, image.y, 0 });
+	AddToIndex(shelves_.size() - 1);
+	return shelves_.size() - 1;
+}
+
+void Shelf::AddToIndex(int shelf)
+{
+	const OpenShelf& open_shelf = shelves_[shelf];
+	int free_width = padded_size_.x - open_shelf.width;
+	if (rule_ == ShelfRule::FirstFit) {
+		free_widths_.Set(shelf, free_width);
+		return;
+	}
+
+	std::set<std::pair<int, int>>& same_height = shelves_by_height_[open_shelf.height];
+	same_height.insert({ free_width, shelf });
+	free_widths_.Set(open_shelf.height, same_height.rbegin()->first);
+}
+
+void Shelf::UpdateIndex(int shelf, OpenShelf old_shelf)
+{
+	if (rule_ == ShelfRule::FirstFit) {
+		free_widths_.Set(shelf, padded_size_.x - shelves_[shelf].width);
+		return;
+	}
+
+	//the set entry is moved instead of erased and inserted again, so placing an image allocates nothing
+	std::set<std::pair<int, int>>& old_height = shelves_by_height_[old_shelf.height];
+	auto entry = old_height.extract({ padded_size_.x - old_shelf.width, shelf });
+	free_widths_.Set(old_shelf.height, old_height.empty() ? -1 : old_height.rbegin()->first);
+
+	const OpenShelf& open_shelf = shelves_[shelf];
+	std::set<std::pair<int, int>>& same_height = shelves_by_height_[open_shelf.height];
+	entry.value().first = padded_size_.x - open_shelf.width;
+	same_height.insert(std::move(entry));
+	free_widths_.Set(open_shelf.height, same_height.rbegin()->first);
+}
+
+void Shelf::MaxTree::Reset(int size)
+{
+	num_leaves = 1;
+	while (num_leaves < size) {
+		num_leaves *= 2;
+	}
+	values.assign(2 * num_leaves, -1);
+}
+
+void Shelf::MaxTree::Set(int index, int value)
+{
+	int node = num_leaves + index;
+	values[node] = value;
+	//stops once a node keeps its value, since everything above it does too
+	for (node /= 2; node > 0; node /= 2) {
+		int max_value = std::max(values[2 * node], values[2 * node + 1]);
+		if (values[node] == max_value) {
+			break;
+		}
+		values[node] = max_value;
+	}
+}
+
+int Shelf::MaxTree::FindFirst(int from, int min_value) const
+{
+	if (from >= num_leaves) {
+		return -1;
+	}
+
+	//climbs until a subtree to the right of the leaf holds a large enough value, then goes down its left most branch
+	//that does
+	int node = num_leaves + from;
+	while (values[node] < min_value) {
+		while (node % 2 == 1) {
+			if (node == 1) {
+				return -1;
+			}
+			node /= 2;
+		}
+		++node;
+	}
+	while (node < num_leaves) {
+		node = values[2 * node] >= min_value ? 2 * node : 2 * node + 1;
+	}
+	return node - num_leaves;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ImageData.h"
+
+#include <set>
+#include <utility>
+#include <vector>
+
+//rule used to choose which open shelf an image goes on. a new shelf is only started once no open shelf has room
+enum class ShelfRule
+{
+	//only the last shelf is open, earlier ones are closed once an image does not fit
+	NextFit,
+	//the highest shelf in the atlas with room for the image
+	FirstFit,
+	//the shelf with the least height left above the image
+	BestHeightFit
+};
+
+//row packer. images are placed left to right along a shelf, and a new shelf starts below the last once the image does
+//not fit on the open ones. each shelf is as tall as the tallest image on it. keeps where it stopped so a failed attempt
+//can carry on in a taller atlas
+class Shelf
+{
+public:
+	//places rects in sorted_indices order. packs best sorted by height, or by short side with allow_rotation
+	bool PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, ShelfRule rule = ShelfRule::NextFit);
+	//carries on from the first image the last call could not place. placements only depend on the width, so in an atlas
+	//of the same width that is at least as tall, this gives the same result as packing from the start. otherwise, or if
+	//the last call succeeded, packs from the start. rects and settings must be the same as in the last call
+	bool ResumeTaller(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, ShelfRule rule = ShelfRule::NextFit);
+private:
+	//largest value over ranges of entries, so the first entry from some index on with at least a given value is found
+	//in O(log n)
+	struct MaxTree
+	{
+		void Reset(int size);
+		void Set(int index, int value);
+		//-1 if there is none
+		int FindFirst(int from, int min_value) const;
+
+		std::vector<int> values;
+		int num_leaves = 0;
+	};
+
+	//in the atlas with padding added, the same as the images on it
+	struct OpenShelf
+	{
+		int y = 0;
+		int height = 0;
+		int width = 0;
+	};
+
+	bool PackRemaining(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation);
+	bool PackShelves(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding);
+	bool PackShelvesRotated(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding);
+	bool PackOpenShelves(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation);
+	int FindShelf(Vec2 image) const;
+	bool IsBetterShelf(int shelf, Vec2 image, int other_shelf, Vec2 other_image) const;
+	//grows the last shelf to fit the image, or starts a new one below it. -1 if the atlas is not tall enough
+	int MakeRoom(Vec2 image);
+	void AddToIndex(int shelf);
+	//moves a shelf in the lookup from where old_shelf had it
+	void UpdateIndex(int shelf, OpenShelf old_shelf);
+
+	//pen position before the first image that did not fit. failed_image_ is -1 if the last attempt succeeded
+	int failed_image_ = -1;
+	Vec2 size_;
+	int pen_x_ = 0;
+	int pen_y_ = 0;
+	int shelf_height_ = 0;
+
+	//first and best height fit keep every shelf open. first fit looks them up by position and best height fit by
+	//height, each holding the free width left on the shelves
+	ShelfRule rule_ = ShelfRule::NextFit;
+	Vec2 padded_size_;
+	std::vector<OpenShelf> shelves_;
+	MaxTree free_widths_;
+	//shelves of each height by their free width, ties going to the highest
+	std::vector<std::set<std::pair<int, int>>> shelves_by_height_;
+};
\ No newline at end of file
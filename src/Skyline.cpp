@@ -0,0 +1,228 @@
+#include "Skyline.h"
+
+#include <algorithm>
+#include <climits>
+
+bool Skyline::PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, const std::atomic<bool>* cancelled)
+{
+	size_ = { size.x + padding, size.y + padding };
+	skyline_.clear();
+	waste_rects_.clear();
+
+	if (size.x > 0 && size.y > 0) {
+		skyline_.push_back({ 0, 0, size_.x });
+	}
+
+	failed_image_ = 0;
+	return PackRemaining(rects, sorted_indices, padding, allow_rotation, cancelled);
+}
+
+bool Skyline::ResumeTaller(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, const std::atomic<bool>* cancelled)
+{
+	//an atlas without height never had a skyline to carry on from
+	if (failed_image_ == -1 || size.x + padding != size_.x || size.y + padding < size_.y || size_.y <= padding) {
+		return PackAtlas(rects, size, sorted_indices, padding, allow_rotation, cancelled);
+	}
+
+	size_.y = size.y + padding;
+	return PackRemaining(rects, sorted_indices, padding, allow_rotation, cancelled);
+}
+
+bool Skyline::PackRemaining(Rect* rects, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, const std::atomic<bool>* cancelled)
+{
+	//nothing changes until an image is placed, so after a failure everything is still as it was before the failed image
+	for (; failed_image_ < sorted_indices.size(); ++failed_image_) {
+
+		if (cancelled != nullptr && *cancelled) {
+			return false;
+		}
+
+		int curr_idx = sorted_indices[failed_image_];
+		Rect padded = { 0, 0, rects[curr_idx].w + padding, rects[curr_idx].h + padding };
+
+		bool can_turn = allow_rotation && padded.w != padded.h;
+		Rect turned = { 0, 0, padded.h, padded.w };
+		rects[curr_idx].rotated = false;
+
+		//gaps under the skyline never move the skyline, so fill them before anything else
+		int waste_index = FindBestWasteRect(padded.w, padded.h);
+		if (can_turn) {
+			int turned_index = FindBestWasteRect(turned.w, turned.h);
+			if (turned_index != -1 && (waste_index == -1 || WasteScore(turned_index, turned.w, turned.h) < WasteScore(waste_index, padded.w, padded.h))) {
+				waste_index = turned_index;
+				padded = turned;
+				rects[curr_idx].rotated = true;
+			}
+		}
+
+		if (waste_index != -1) {
+			padded.x = rects[curr_idx].x = waste_rects_[waste_index].x;
+			padded.y = rects[curr_idx].y = waste_rects_[waste_index].y;
+			PlaceInWasteRect(waste_index, padded);
+			continue;
+		}
+
+		int best_y = 0;
+		int node_index = FindBestNode(padded.w, padded.h, best_y);
+		if (can_turn) {
+			int turned_y = 0;
+			int turned_node = FindBestNode(turned.w, turned.h, turned_y);
+			if (turned_node != -1 && (node_index == -1 || turned_y + turned.h < best_y + padded.h ||
+				(turned_y + turned.h == best_y + padded.h && skyline_[turned_node].w < skyline_[node_index].w))) {
+				node_index = turned_node;
+				best_y = turned_y;
+				padded = turned;
+				rects[curr_idx].rotated = true;
+			}
+		}
+
+		//didnt find any fits
+		if (node_index == -1) {
+			return false;
+		}
+
+		padded.x = rects[curr_idx].x = skyline_[node_index].x;
+		padded.y = rects[curr_idx].y = best_y;
+		AddSkylineLevel(node_index, padded);
+	}
+
+	failed_image_ = -1;
+	return true;
+}
+
+bool Skyline::FitsAtNode(int node_index, int width, int height, int& y) const
+{
+	if (skyline_[node_index].x + width > size_.x) {
+		return false;
+	}
+
+	//image rests on the lowest of the nodes it spans. nodes always cover the whole width, so this never runs off the end
+	y = skyline_[node_index].y;
+	int width_left = width;
+	for (int i = node_index; width_left > 0; ++i) {
+		y = std::max(y, skyline_[i].y);
+		if (y + height > size_.y) {
+			return false;
+		}
+		width_left -= skyline_[i].w;
+	}
+
+	return true;
+}
+
+int Skyline::FindBestNode(int width, int height, int& best_y) const
+{
+	//lowest bottom edge wins, ties go to the narrowest node so wide nodes are left for wide images
+	int best_node = -1;
+	int best_bottom = INT_MAX;
+	int best_width = INT_MAX;
+
+	for (int i = 0; i < skyline_.size(); ++i) {
+		int y = 0;
+		if (!FitsAtNode(i, width, height, y)) {
+			continue;
+		}
+
+		if (y + height < best_bottom || (y + height == best_bottom && skyline_[i].w < best_width)) {
+			best_node = i;
+			best_bottom = y + height;
+			best_width = skyline_[i].w;
+			best_y = y;
+		}
+	}
+
+	return best_node;
+}
+
+void Skyline::AddSkylineLevel(int node_index, const Rect& rect)
+{
+	//anything between the nodes the image spans and the bottom of the image can no longer be reached from the skyline
+	for (int i = node_index; i < skyline_.size() && skyline_[i].x < rect.x + rect.w; ++i) {
+		int right = std::min(skyline_[i].x + skyline_[i].w, rect.x + rect.w);
+		if (rect.y > skyline_[i].y) {
+			waste_rects_.push_back({ skyline_[i].x, skyline_[i].y, right - skyline_[i].x, rect.y - skyline_[i].y });
+		}
+	}
+
+	skyline_.insert(skyline_.begin() + node_index, { rect.x, rect.y + rect.h, rect.w });
+
+	//cut the nodes now covered by the new one
+	for (int i = node_index + 1; i < skyline_.size();) {
+		int covered = skyline_[i - 1].x + skyline_[i - 1].w - skyline_[i].x;
+		if (covered <= 0) {
+			break;
+		}
+
+		skyline_[i].x += covered;
+		skyline_[i].w -= covered;
+		if (skyline_[i].w > 0) {
+			break;
+		}
+		skyline_.erase(skyline_.begin() + i);
+	}
+
+	//merge neighbours at the same height
+	for (int i = 0; i + 1 < skyline_.size();) {
+		if (skyline_[i].y == skyline_[i + 1].y) {
+			skyline_[i].w += skyline_[i + 1].w;
+			skyline_.erase(skyline_.begin() + i + 1);
+		}
+		else {
+			++i;
+		}
+	}
+}
+
+int Skyline::FindBestWasteRect(int width, int height) const
+{
+	//best short side fit, ties go to the oldest waste rect
+	int best_index = -1;
+	int best_score = INT_MAX;
+
+	for (int i = 0; i < waste_rects_.size(); ++i) {
+		if (waste_rects_[i].w < width || waste_rects_[i].h < height) {
+			continue;
+		}
+
+		int score = WasteScore(i, width, height);
+		if (score < best_score) {
+			best_index = i;
+			best_score = score;
+		}
+	}
+
+	return best_index;
+}
+
+int Skyline::WasteScore(int waste_index, int width, int height) const
+{
+	return std::min(waste_rects_[waste_index].w - width, waste_rects_[waste_index].h - height);
+}
+
+void Skyline::PlaceInWasteRect(int waste_index, const Rect& rect)
+{
+	Rect waste = waste_rects_[waste_index];
+	waste_rects_.erase(waste_rects_.begin() + waste_index);
+
+	//guillotine split along the shorter leftover side, so the larger of the two leftover rects stays as big as possible
+	int leftover_width = waste.w - rect.w;
+	int leftover_height = waste.h - rect.h;
+
+	Rect bottom = { waste.x, waste.y + rect.h, 0, leftover_height };
+	Rect right = { waste.x + rect.w, waste.y, leftover_width, 0 };
+	if (leftover_width <= leftover_height) {
+		bottom.w = waste.w;
+		right.h = rect.h;
+	}
+	else {
+		bottom.w = rect.w;
+		right.h = waste.h;
+	}
+
+	if (bottom.w > 0 && bottom.h > 0) {
+		waste_rects_.push_back(bottom);
+	}
+	if (right.w > 0 && right.h > 0) {
+		waste_rects_.push_back(right);
+	}
+}
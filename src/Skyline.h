@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ImageData.h"
+
+#include <atomic>
+#include <vector>
+
+//bottom left skyline packer. y grows downwards, so the skyline is the lowest used edge across each column span of the
+//atlas and images are placed as close to the top as possible. gaps left under the skyline go into a waste map and are
+//filled by later images first. each instance keeps its own lists so separate instances can pack concurrently
+class Skyline
+{
+public:
+	//places rects in sorted_indices order, turning them when that fits better if allow_rotation is set.
+	//stops early and returns false if cancelled is set while packing
+	bool PackAtlas(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, const std::atomic<bool>* cancelled = nullptr);
+	//carries on from the first image the last call could not place. a taller atlas only lets images rest on nodes where
+	//they end up lower than anything that fit before, so in an atlas of the same width that is at least as tall, this
+	//gives the same result as packing from the start. otherwise, or if the last call succeeded, packs from the start.
+	//rects and settings must be the same as in the last call
+	bool ResumeTaller(Rect* rects, Vec2 size, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, const std::atomic<bool>* cancelled = nullptr);
+private:
+	//span of the skyline from x to x + w, with everything above y used
+	struct SkylineNode
+	{
+		int x = 0;
+		int y = 0;
+		int w = 0;
+	};
+
+	bool PackRemaining(Rect* rects, const std::vector<int>& sorted_indices, int padding, bool allow_rotation, const std::atomic<bool>* cancelled);
+	bool FitsAtNode(int node_index, int width, int height, int& y) const;
+	int FindBestNode(int width, int height, int& best_y) const;
+	void AddSkylineLevel(int node_index, const Rect& rect);
+
+	int FindBestWasteRect(int width, int height) const;
+	int WasteScore(int waste_index, int width, int height) const;
+	void PlaceInWasteRect(int waste_index, const Rect& rect);
+
+	Vec2 size_;
+	std::vector<SkylineNode> skyline_;
+	std::vector<Rect> waste_rects_;
+	//first image not placed yet, -1 once every image is
+	int failed_image_ = -1;
+};
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(int num_workers)
+{
+	for (int i = 0; i < num_workers; ++i) {
+		workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	job_available_.notify_all();
+
+	for (auto& worker : workers_) {
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::Shared()
+{
+	//calling thread always takes part, so one less worker than there are hardware threads
+	static ThreadPool pool(std::max(1, (int)std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+
+void ThreadPool::ParallelFor(int count, const std::function<void(int)>& func)
+{
+	if (workers_.empty() || count <= 1) {
+		for (int i = 0; i < count; ++i) {
+			func(i);
+		}
+		return;
+	}
+
+	auto job = std::make_shared<Job>();
+	job->func = &func;
+	job->count = count;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.push_back(job);
+	}
+	job_available_.notify_all();
+
+	RunTasks(*job);
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	job_finished_.wait(lock, [&job]() { return job->num_done == job->count; });
+
+	//workers only remove a job once they find no indices left, so it may still be queued
+	auto it = std::find(jobs_.begin(), jobs_.end(), job);
+	if (it != jobs_.end()) {
+		jobs_.erase(it);
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true) {
+		std::shared_ptr<Job> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			job_available_.wait(lock, [this]() { return stopping_ || !jobs_.empty(); });
+			if (stopping_) {
+				return;
+			}
+
+			job = jobs_.front();
+			if (job->next_index >= job->count) {
+				jobs_.pop_front();
+				continue;
+			}
+		}
+
+		RunTasks(*job);
+	}
+}
+
+void ThreadPool::RunTasks(Job& job)
+{
+	for (int i = job.next_index++; i < job.count; i = job.next_index++) {
+		(*job.func)(i);
+
+		if (++job.num_done == job.count) {
+			//lock so the waiting thread cannot miss the notification between checking and sleeping
+			std::lock_guard<std::mutex> lock(mutex_);
+			job_finished_.notify_all();
+		}
+	}
+}
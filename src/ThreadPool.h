@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//fixed set of worker threads shared by everything that runs in parallel.
+//the calling thread also runs tasks while it waits, so ParallelFor can be nested inside a task without deadlocking
+class ThreadPool
+{
+public:
+	explicit ThreadPool(int num_workers);
+	~ThreadPool();
+
+	static ThreadPool& Shared();
+
+	//calls func(i) for every i in [0, count). indices are handed out in ascending order. returns once every call has returned
+	void ParallelFor(int count, const std::function<void(int)>& func);
+	int NumThreads() const { return (int)workers_.size() + 1; }
+
+private:
+	struct Job
+	{
+		const std::function<void(int)>* func = nullptr;
+		int count = 0;
+		std::atomic<int> next_index = 0;
+		std::atomic<int> num_done = 0;
+	};
+
+	void WorkerLoop();
+	void RunTasks(Job& job);
+
+	std::vector<std::thread> workers_;
+	std::deque<std::shared_ptr<Job>> jobs_;
+	std::mutex mutex_;
+	std::condition_variable job_available_;
+	std::condition_variable job_finished_;
+	bool stopping_ = false;
+};
\ No newline at end of file
@@ -8,18 +8,47 @@ void OutputHelpMessage()
 	help += "All arguments before the first option will be considered to be an image folder/file.\n\n";
 
 	help += "Option List:\n";
-	help += "--algorithm | -a  <shelf | max-rects>\t\tAlgorithm used to Pack Atlas [default: shelf].\n\n";
-	help += "--size-solver | -ss  <fast | fixed | best-fit>\tSize Solver used to determine size of the atlas [default: fast].\n\n";
+	help += "--algorithm | -a  <shelf | max-rects | skyline | guillotine | auto>\n";
+	help += "\t\t\t\t\t\tAlgorithm used to Pack Atlas. auto picks one, and the Fast or Best Fit size solver, from the image sizes [default: shelf].\n\n";
+	help += "--shelf-rule | -sr  <next-fit | first-fit | best-height-fit>\n";
+	help += "\t\t\t\t\t\tRule Shelf uses to choose which shelf each image goes on [default: next-fit].\n\n";
+	help += "--heuristic | -hr  <short-side | long-side | area | bottom-left | contact-point | best>\n";
+	help += "\t\t\t\t\t\tRule MaxRects uses to place each image. best tries them all and keeps the smallest atlas [default: short-side].\n\n";
+	help += "--guillotine-split | -gs  <shorter-axis | longer-axis | min-area | max-area>\n";
+	help += "\t\t\t\t\t\tRule Guillotine uses to cut the free area left around each image [default: shorter-axis].\n\n";
+	help += "--no-guillotine-merge | -ngm\t\t\tStops Guillotine from joining free areas that share an edge. Faster but packs worse.\n\n";
+	help += "--sort-order | -so  <height | width | area | perimeter | max-side | ratio | all>\n";
+	help += "\t\t\t\t\t\tSize images are sorted by before packing, largest first. all tries them all and keeps the smallest atlas [default: height].\n\n";
+	help += "--size-solver | -ss  <fast | fixed | best-fit | optimize | exact>\n";
+	help += "\t\t\t\t\t\tSize Solver used to determine size of the atlas [default: fast].\n\n";
+	help += "--verify-size | -vs\t\t\t\tAfter the Best Fit search, also tries every smaller size one pixel at a time. Slow.\n\n";
+	help += "--no-grids | -ng\t\t\t\tPacks images of the same or nearly the same size one by one instead of laying them out as grids.\n\n";
+	help += "--time-budget-ms | -tb  <MS>\t\t\tWall clock milliseconds the Optimize size solver spends on Best Fit with the chosen and other\n";
+	help += "\t\t\t\t\t\talgorithms and orders, or the Exact size solver spends on Best Fit and searching. Both keep the Fast\n";
+	help += "\t\t\t\t\t\tsize solver's atlas if nothing smaller packs in time [default: 1000].\n\n";
+	help += "--exact-width | -ew  <WIDTH>\t\t\tWidth the Exact size solver finds the shortest height for. 0 finds the smallest area [default: 0].\n\n";
 
 	help += "--padding | -p  <NUM_PIXELS>\t\t\tPadding of NUM_PIXELS is applied between each image. Max: 32 [default: 0].\n\n";
 
 	help += "--dimensions | -d  <WIDTH HEIGHT>\t\tSets the maximum dimensions to WIDTH and HEIGHT respectively. Max: 4096 4096.\n";
 	help += "\t\t\t\t\t\tIf Size Solver is Fixed then is used as the fixed size [default: 4096 4096].\n\n";
 
+	help += "--parallel-sizes | -ps  <NUM>\t\t\tPacks the next NUM candidate sizes at once on separate threads.\n";
+	help += "\t\t\t\t\t\tGives the same atlas as packing one at a time. Max: 64 [default: 1].\n\n";
+
 	help += "--force-square | -fs\t\t\t\tForces atlas to have the same width and height. Ignored if Size Solver is Fixed.\n\n";
 
 	help += "--power-of-two | -pot\t\t\t\tForces atlas to have power of two dimensions. Ignored if Size Solver is Fixed.\n\n";
 
+	help += "--allow-rotation | -ar\t\t\t\tLets images be turned 90 degrees clockwise when that packs better.\n";
+	help += "\t\t\t\t\t\tTurned images are marked with rotated: 1 in the metadata.\n\n";
+
+	help += "--multi-page | -mp\t\t\t\tImages that do not fit in the maximum dimensions go on further atlases named atlas_0, atlas_1...\n";
+	help += "\t\t\t\t\t\tThe page of each image is recorded in the metadata.\n\n";
+
+	help += "--layout-only | -lo\t\t\t\tOnly reads the size of each image and saves the metadata without the atlas image.\n";
+	help += "\t\t\t\t\t\tMuch faster, for when only the layout is needed.\n\n";
+
 	help += "--output-format | -of  <png | jpg>\t\tSets the file format of the atlas [default: png].\n\n";
 
 	help += "--output-directory | -od  <FOLDER>\t\tSets the output directory of the atlas to FOLDER [default: executable directory].\n\n";